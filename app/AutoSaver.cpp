@@ -0,0 +1,245 @@
+#include "AutoSaver.hpp"
+#include "model/Document.hpp"
+#include "trace/Trace.hpp"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QMetaObject>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+
+namespace {
+
+QString autosaveDirectory()
+{
+    const QString dir = AutoSaver::settings().directory;
+    return dir.isEmpty() ? AutoSaver::defaultDirectory() : dir;
+}
+
+// 恢复文件名：已保存过的文档按完整路径的哈希命名，同一文档总是对应同一个恢复文件；
+// 新建的文档按创建时间和进程号命名
+QString recoveryPathFor(const QString& source)
+{
+    QString name;
+    if (source.isEmpty()) {
+        name = QString("untitled-%1-%2")
+                   .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmsszzz"))
+                   .arg(QCoreApplication::applicationPid());
+    } else {
+        const QFileInfo info(source);
+        const QByteArray hash = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(),
+                                                         QCryptographicHash::Sha1).toHex().left(16);
+        name = info.completeBaseName() + "-" + QString::fromLatin1(hash);
+    }
+    return QDir(autosaveDirectory()).filePath(name + ".fdb");   // 二进制格式，写入和恢复都最快
+}
+
+// 恢复文件旁边的说明文件，记录所属文档
+QString infoPathFor(const QString& recoveryFile)
+{
+    return recoveryFile + ".info";
+}
+
+// 恢复文件旁边的锁文件，跟踪期间由所属进程持有
+QString lockPathFor(const QString& recoveryFile)
+{
+    return recoveryFile + ".lock";
+}
+
+// 恢复文件是否正被另一个仍在运行的 FlowDraw 使用（进程已退出时锁文件视为过期）
+bool inUse(const QString& recoveryFile)
+{
+    QLockFile lock(lockPathFor(recoveryFile));
+    lock.setStaleLockTime(0);   // 只按进程是否存在判断，不按时间
+    return !lock.tryLock(0);
+}
+
+// 在工作线程中写出恢复文件：先写临时文件再替换，写到一半时旧的恢复文件仍然可用
+bool writeRecoveryFile(const Document& doc, const QString& path, const QString& source)
+{
+    const QFileInfo info(path);
+    if (!QDir().mkpath(info.path())) return false;
+
+    const QString temp = info.dir().filePath(".~" + info.fileName());
+    if (!doc.saveToFile(temp)) {
+        QFile::remove(temp);
+        return false;
+    }
+    QFile::remove(path);
+    if (!QFile::rename(temp, path)) return false;
+
+    QJsonObject meta;
+    meta["source"] = source;
+    QSaveFile out(infoPathFor(path));
+    return out.open(QIODevice::WriteOnly)
+        && out.write(QJsonDocument(meta).toJson(QJsonDocument::Compact)) > 0
+        && out.commit();
+}
+
+} // namespace
+
+AutoSaver::Settings AutoSaver::settings()
+{
+    QSettings s;
+    Settings result;
+    result.intervalSeconds = qMax(0, s.value("autosave/interval", result.intervalSeconds).toInt());
+    result.directory = s.value("autosave/directory").toString();
+    return result;
+}
+
+void AutoSaver::setSettings(const Settings& settings)
+{
+    QSettings s;
+    s.setValue("autosave/interval", settings.intervalSeconds);
+    s.setValue("autosave/directory", settings.directory);
+}
+
+QString AutoSaver::defaultDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("autosave");
+}
+
+QList<AutoSaver::RecoveryFile> AutoSaver::recoveryFiles()
+{
+    QList<RecoveryFile> result;
+    const QDir dir(autosaveDirectory());
+    const QFileInfoList files = dir.entryInfoList(QStringList() << "*.fdb", QDir::Files, QDir::Time);
+    for (const QFileInfo& info : files) {
+        RecoveryFile file;
+        file.path = info.filePath();
+        if (inUse(file.path)) continue;   // 另一个实例的恢复文件，不是异常退出留下的
+        file.saved = info.lastModified();
+
+        QFile meta(infoPathFor(file.path));
+        if (meta.open(QIODevice::ReadOnly)) {
+            file.source = QJsonDocument::fromJson(meta.readAll()).object()["source"].toString();
+        }
+        result.push_back(file);
+    }
+    return result;
+}
+
+AutoSaver::RecoveryFile AutoSaver::recoveryFileFor(const QString& source)
+{
+    RecoveryFile file;
+    const QString path = recoveryPathFor(source);
+    if (!source.isEmpty() && QFileInfo::exists(path) && !inUse(path)) {
+        file.path = path;
+        file.source = source;
+        file.saved = QFileInfo(path).lastModified();
+    }
+    return file;
+}
+
+void AutoSaver::discard(const QString& recoveryFile)
+{
+    if (recoveryFile.isEmpty()) return;
+    QFile::remove(recoveryFile);
+    QFile::remove(infoPathFor(recoveryFile));
+}
+
+AutoSaver::AutoSaver(const Document& doc, QObject* parent)
+    : QObject(parent)
+    , doc_(doc)
+{
+    connect(&timer_, &QTimer::timeout, this, &AutoSaver::tick);
+}
+
+AutoSaver::~AutoSaver()
+{
+    cancel();
+}
+
+void AutoSaver::track(const QString& source, const QString& reuse)
+{
+    const QString recoveryFile = reuse.isEmpty() ? recoveryPathFor(source) : reuse;
+
+    // 上一个文档已正常关闭，它的恢复文件不再需要
+    cancel();
+    if (tracking_ && recoveryFile_ != recoveryFile) discard(recoveryFile_);
+
+    // 持有锁文件，其他实例启动时不会把这个恢复文件当作异常退出留下的
+    if (!lock_ || recoveryFile_ != recoveryFile) {
+        lock_.reset();
+        QDir().mkpath(QFileInfo(recoveryFile).path());
+        lock_ = std::make_unique<QLockFile>(lockPathFor(recoveryFile));
+        lock_->setStaleLockTime(0);
+        lock_->tryLock(0);
+    }
+
+    source_ = source;
+    recoveryFile_ = recoveryFile;
+    dirty_ = false;
+    tracking_ = true;
+    applySettings();
+}
+
+void AutoSaver::stop()
+{
+    cancel();
+    if (tracking_) discard(recoveryFile_);
+    lock_.reset();   // 释放时删除锁文件
+
+    tracking_ = false;
+    dirty_ = false;
+    recoveryFile_.clear();
+    timer_.stop();
+}
+
+void AutoSaver::applySettings()
+{
+    const Settings s = settings();
+    if (!tracking_ || s.intervalSeconds <= 0) {
+        timer_.stop();
+        return;
+    }
+    timer_.start(s.intervalSeconds * 1000);
+}
+
+void AutoSaver::actionApplied(const ActionRecord&, bool)
+{
+    if (tracking_) dirty_ = true;
+}
+
+void AutoSaver::pageChanged(const QColor&, const QSize&, bool)
+{
+    if (tracking_) dirty_ = true;
+}
+
+void AutoSaver::tick()
+{
+    // 上一次保存还没写完时跳过，留到下一次
+    if (!tracking_ || suspended_ || running_ || !dirty_) return;
+
+    std::shared_ptr<const Document> snapshot = doc_.snapshot();
+    dirty_ = false;
+    running_ = true;
+    const int generation = ++generation_;
+
+    thread_ = std::thread([this, snapshot, path = recoveryFile_, source = source_, generation]() {
+        TraceSpan span("AutoSaver::save", "io");
+        span.arg("shapes", snapshot->shapes.size());
+        const bool ok = writeRecoveryFile(*snapshot, path, source);
+
+        QMetaObject::invokeMethod(this, [this, generation, ok]() {
+            if (generation != generation_) return;
+            if (thread_.joinable()) thread_.join();
+            running_ = false;
+            if (!ok) dirty_ = true;   // 写入失败时下一次重写
+        }, Qt::QueuedConnection);
+    });
+}
+
+void AutoSaver::cancel()
+{
+    ++generation_;
+    if (thread_.joinable()) thread_.join();
+    running_ = false;
+}
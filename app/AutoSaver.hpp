@@ -0,0 +1,89 @@
+#pragma once
+#include <QDateTime>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <memory>
+#include <thread>
+
+#include "model/History.hpp"
+
+class Document;
+class QLockFile;
+
+/* 后台自动保存
+
+   AutoSaver 作为 EditObserver 只记录文档自上次自动保存以来是否有修改。定时器到期时
+   在编辑线程取一个文档快照（Document::snapshot，O(1)，不复制图形），由工作线程把快照
+   写入恢复文件；之后的编辑只复制被修改的图形，不影响正在写出的快照，编辑线程始终不被阻塞。
+
+   恢复文件只在异常退出时留下：文档保存、关闭或正常退出时都会删除。跟踪期间在恢复文件
+   旁边持有一个锁文件（QLockFile，记录进程号），同时运行的其他实例不会把它当作异常退出留下的。
+   已经由编辑日志（Journal）逐条记录的文档不需要自动保存，由调用方停止跟踪。 */
+class AutoSaver : public QObject, public EditObserver
+{
+    Q_OBJECT
+
+public:
+    // 自动保存设置（保存在 QSettings 中）
+    struct Settings {
+        int     intervalSeconds = 60;   // 保存间隔，0 表示关闭自动保存
+        QString directory;              // 恢复文件目录，为空时使用默认目录
+    };
+    static Settings settings();
+    static void setSettings(const Settings& settings);
+    static QString defaultDirectory();
+
+    // 异常退出后留下的恢复文件
+    struct RecoveryFile {
+        QString   path;                 // 恢复文件
+        QString   source;               // 所属文档，新建未保存的文档为空
+        QDateTime saved;                // 最后一次自动保存的时间
+    };
+    // 恢复目录中的所有恢复文件（按保存时间从新到旧）
+    static QList<RecoveryFile> recoveryFiles();
+    // 指定文档的恢复文件，不存在时 path 为空
+    static RecoveryFile recoveryFileFor(const QString& source);
+    // 删除恢复文件
+    static void discard(const QString& recoveryFile);
+
+    explicit AutoSaver(const Document& doc, QObject* parent = nullptr);
+    ~AutoSaver() override;
+
+    /* 开始跟踪当前文档（此时的内容视为已保存）
+       source 为文档所属的文件（新建文档为空）；reuse 不为空时继续写入这个恢复文件 */
+    void track(const QString& source, const QString& reuse = QString());
+    // 停止跟踪并删除恢复文件（文档已保存、已关闭，或改由编辑日志记录）
+    void stop();
+    bool isTracking() const { return tracking_; }
+    // 文档有没有经过观察者通知的修改（如刚恢复的未保存编辑）
+    void markModified() { if (tracking_) dirty_ = true; }
+    // 暂停自动保存（文档正在后台加载，内容不完整）
+    void setSuspended(bool suspended) { suspended_ = suspended; }
+    // 当前文档的恢复文件（尚未写出时文件不存在）
+    QString recoveryFile() const { return recoveryFile_; }
+
+    // 设置修改后重新启动定时器
+    void applySettings();
+
+    void actionApplied(const ActionRecord& record, bool forward) override;
+    void pageChanged(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) override;
+
+private:
+    void tick();                 // 定时器到期：取快照交给工作线程
+    void cancel();               // 等待工作线程结束
+
+    const Document&     doc_;
+    QTimer              timer_;
+    bool                tracking_ = false;
+    bool                suspended_ = false;
+    bool                dirty_ = false;        // 上次自动保存之后有修改
+    QString             source_;
+    QString             recoveryFile_;
+    std::unique_ptr<QLockFile> lock_;          // 当前恢复文件的锁
+
+    std::thread         thread_;
+    bool                running_ = false;
+    int                 generation_ = 0;       // 只在 GUI 线程中读写，用于丢弃过期的结果
+};
@@ -0,0 +1,134 @@
+#include "DocumentLoader.hpp"
+
+#include <QMetaObject>
+
+// 加载线程一侧的接收端：把内容放入 DocumentLoader 的队列
+class DocumentLoader::QueueSink : public LoadSink
+{
+public:
+    QueueSink(DocumentLoader* loader, int generation) : loader_(loader), generation_(generation) {}
+
+    void page(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(loader_->mutex_);
+            Pending& p = loader_->pending_;
+            p.hasPage = true;
+            p.backgroundColor = backgroundColor;
+            p.pageSize = pageSize;
+            p.showGrid = showGrid;
+        }
+        loader_->notify(generation_);
+    }
+
+    void shapes(std::vector<LoadedShape>&& batch) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(loader_->mutex_);
+            auto& shapes = loader_->pending_.shapes;
+            if (shapes.empty()) {
+                shapes = std::move(batch);
+            } else {
+                for (auto& s : batch) shapes.push_back(std::move(s));
+            }
+        }
+        loader_->notify(generation_);
+    }
+
+    void connectors(std::vector<ConnectorSpec>&& list) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(loader_->mutex_);
+            loader_->pending_.hasConnectors = true;
+            loader_->pending_.connectors = std::move(list);
+        }
+        loader_->notify(generation_);
+    }
+
+    void progress(qint64 done, qint64 total) override
+    {
+        if (total <= 0) return;
+        std::lock_guard<std::mutex> lock(loader_->mutex_);
+        loader_->percent_ = static_cast<int>(qBound<qint64>(0, done * 100 / total, 100));
+    }
+
+    bool cancelled() const override { return loader_->cancelled_; }
+
+private:
+    DocumentLoader* loader_;
+    int             generation_;
+};
+
+DocumentLoader::DocumentLoader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+DocumentLoader::~DocumentLoader()
+{
+    cancel();
+}
+
+void DocumentLoader::start(const QString& filename, const QRectF& priority)
+{
+    cancel();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = Pending();
+        percent_ = 0;
+    }
+    cancelled_ = false;
+    notified_ = false;
+    running_ = true;
+    const int generation = ++generation_;
+
+    thread_ = std::thread([this, filename, priority, generation]() {
+        QueueSink sink(this, generation);
+        bool ok = loadDocumentProgressive(filename, sink, priority);
+        if (cancelled_) return;
+
+        // 完成通知排在所有数据通知之后，GUI 线程先取走剩余数据再结束
+        QMetaObject::invokeMethod(this, [this, ok, generation]() {
+            if (generation != generation_) return;   // 已被取消或开始了新的加载
+            emit dataAvailable();
+            if (thread_.joinable()) thread_.join();
+            running_ = false;
+            emit progressChanged(100);
+            emit finished(ok);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DocumentLoader::cancel()
+{
+    ++generation_;   // 让已投递但尚未执行的通知失效
+    cancelled_ = true;
+    if (thread_.joinable()) thread_.join();
+    running_ = false;
+}
+
+DocumentLoader::Pending DocumentLoader::take()
+{
+    notified_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Pending result = std::move(pending_);
+    pending_ = Pending();
+    return result;
+}
+
+void DocumentLoader::notify(int generation)
+{
+    if (notified_.exchange(true)) return;
+
+    QMetaObject::invokeMethod(this, [this, generation]() {
+        if (generation != generation_) return;
+        int percent;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            percent = percent_;
+        }
+        emit progressChanged(percent);
+        emit dataAvailable();
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <QObject>
+#include <QRectF>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io/LoadSink.hpp"
+
+/* 在后台线程中渐进加载文档
+   加载线程把页面设置、图形批次和连接线放入队列，并通知 GUI 线程；
+   GUI 线程收到 dataAvailable 后调用 take() 取出已加载的内容。 */
+class DocumentLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 一次 take() 取出的内容
+    struct Pending {
+        bool hasPage = false;
+        QColor backgroundColor;
+        QSize pageSize;
+        bool showGrid = true;
+        std::vector<LoadedShape> shapes;
+        bool hasConnectors = false;
+        std::vector<ConnectorSpec> connectors;
+    };
+
+    explicit DocumentLoader(QObject* parent = nullptr);
+    ~DocumentLoader() override;
+
+    // 开始加载（正在加载时先取消上一次），priority 为需要优先加载的文档区域
+    void start(const QString& filename, const QRectF& priority);
+    // 取消加载并等待加载线程退出
+    void cancel();
+    bool isRunning() const { return running_; }
+
+    Pending take();
+
+signals:
+    void dataAvailable();
+    void progressChanged(int percent);
+    void finished(bool ok);
+
+private:
+    class QueueSink;
+
+    void notify(int generation);
+
+    std::thread       thread_;
+    std::atomic<bool> cancelled_{false};
+    std::atomic<bool> notified_{false};   // 合并通知：GUI 线程取走之前不重复投递
+    bool              running_ = false;
+    int               generation_ = 0;         // 只在 GUI 线程中读写，用于丢弃过期的通知
+
+    std::mutex        mutex_;
+    Pending           pending_;
+    int               percent_ = 0;
+};
@@ -13,11 +13,14 @@
 #include <QClipboard>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <QMenu>
 #include <QPainterPath>
-#include <QFile>
-#include <QSvgGenerator>
+#include <QElapsedTimer>
+#include <QTextStream>
 #include "model/TextEditDialog.hpp"
+#include "trace/Trace.hpp"
+#include "model/ShapeFactory.hpp"
 #include "model/Diamond.hpp"
 #include "model/Triangle.hpp"
 #include "model/Ellipse.hpp"
@@ -28,73 +31,677 @@
 #include "model/Capsule.hpp"
 #include "model/RectTriangle.hpp"
 #include <QColorDialog>
+#include <QFile>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QSettings>
 
 /* =====  ===== */
+namespace {
+
+constexpr int    GestureIdleMs = 150;                // 输入停止这么久之后恢复完整画质
+constexpr qint64 FastFrameBudgetNs = 8 * 1000000;    // 完整画质一帧超过 8ms 时，手势中改为快速绘制
+constexpr int    TileSize = 256;                     // 缩放结束后逐块重绘的块大小（像素）
+constexpr qint64 SliceBudgetNs = 8 * 1000000;        // 分片绘制每一片的时间预算
+constexpr int    SliceItems = 256;                   // 分片绘制中两次检查时间之间绘制的元素数量
+constexpr qreal  DragMargin = 16;                    // 拖动区域中描边宽度和箭头的余量（文档坐标）
+constexpr int    DefaultCacheBudgetMB = 256;         // 内容缓存的默认内存预算
+constexpr int    CompactIdleMs = 30 * 1000;          // 保存后这么久没有再保存时，把已保存的记录合并回文件
+
+// ARGB32 像素图占用的内存
+qint64 pixmapBytes(const QSize& size)
+{
+    return qint64(size.width()) * size.height() * 4;
+}
+
+} // namespace
+
 FlowView::FlowView(QWidget* parent)
     : QWidget(parent)
 {
     setMouseTracking(true);
     setFocusPolicy(Qt::ClickFocus);
     setAcceptDrops(true);
+
+    // 后台加载：数据到达时合并进文档，进度和结束转发给主窗口
+    loader_ = new DocumentLoader(this);
+    connect(loader_, &DocumentLoader::dataAvailable, this, &FlowView::applyLoadedData);
+    connect(loader_, &DocumentLoader::progressChanged, this, &FlowView::loadProgress);
+    connect(loader_, &DocumentLoader::finished, this, &FlowView::finishLoad);
+
+    // 编辑日志：提交、撤销、重做都追加到当前文件的日志中，已保存的记录在后台合并回文件
+    doc_.addObserver(&journal_);
+    compactor_ = new JournalCompactor(this);
+    connect(compactor_, &JournalCompactor::finished, this, &FlowView::finishCompaction);
+
+    // 自动保存：新建的文档从空白开始跟踪
+    autosaver_ = new AutoSaver(doc_, this);
+    doc_.addObserver(autosaver_);
+    autosaver_->track(QString());
+
+    lod_ = lodSettings();
+    cacheBudget_ = cacheBudgetBytes();
+
+    gestureIdleTimer_.setSingleShot(true);
+    gestureIdleTimer_.setInterval(GestureIdleMs);
+    connect(&gestureIdleTimer_, &QTimer::timeout, this, &FlowView::endGesture);
+
+    tileTimer_.setInterval(0);
+    connect(&tileTimer_, &QTimer::timeout, this, &FlowView::renderTiles);
+
+    sliceTimer_.setInterval(0);
+    connect(&sliceTimer_, &QTimer::timeout, this, &FlowView::continueRender);
+
+    compactTimer_.setSingleShot(true);
+    compactTimer_.setInterval(CompactIdleMs);
+    connect(&compactTimer_, &QTimer::timeout, this, [this]() {
+        if (journal_.isOpen() && journal_.savedRecords() > 0) {
+            compactor_->start(journal_.documentFile(), journal_.savedRecords());
+        }
+    });
+}
+
+FlowView::~FlowView()
+{
+    // 基准测试时设置 FLOWDRAW_LATENCY_REPORT，退出时输出各类交互的延迟分布
+    if (!qEnvironmentVariableIsEmpty("FLOWDRAW_LATENCY_REPORT")) {
+        QTextStream(stdout) << "input-to-photon latency\n" << latency_.report();
+    }
+    closeJournal();
+    autosaver_->stop();   // 正常退出，不保留恢复文件
 }
 
 /* ======= ���� ======= */
-void FlowView::paintEvent(QPaintEvent*)
+void FlowView::paintEvent(QPaintEvent* event)
 {
+    TraceSpan span("FlowView::paintEvent", "paint");
     QPainter p(this);
-    
-    // 填充窗口背景
-    p.fillRect(rect(), QColor("#f0f0f0")); // 灰色的窗口背景
-    
-    // 绘制页面边界和背景
-    drawPageBorder(p);
-    
-    // 创建剪裁区，只在页面内绘制
-    QRectF pageRect = QRectF(docToView(QPointF(0, 0)), 
-                             docToView(QPointF(pageSize_.width(), pageSize_.height())));
-    p.setClipRect(pageRect);
-    
-    // 应用视图变换
+
+    // 缩放手势进行中：把手势开始时的画面按缩放比例直接贴出来，不重新绘制场景
+    if (!zoomFrame_.isNull()) {
+        const qreal k = scale_ / zoomFrameScale_;
+        p.fillRect(rect(), doc_.isUnbounded() ? doc_.backgroundColor : QColor("#f0f0f0"));
+        p.translate(viewOffset_ - zoomFrameOffset_ * k);
+        p.scale(k, k);
+        p.drawPixmap(0, 0, zoomFrame_);
+        span.arg("zoomPreview", true);
+        latency_.frameCompleted();
+        return;
+    }
+
+    // 手势中的快速绘制：不抗锯齿、不画文字和箭头；其余时候完整画质
+    const bool fast = gestureActive_ && fullFrameNs_ > FastFrameBudgetNs;
+    LodOptions lod = lod_;
+    if (fast) {
+        if (!lod.enabled) lod.shapePixels = lod.pointPixels = 0;
+        lod.enabled = true;
+        lod.textPixels = lod.arrowPixels = std::numeric_limits<qreal>::infinity();
+    }
+
+    // 渲染统计：逐图层计时（关闭统计面板时不计时）
+    QElapsedTimer frameTimer, layerTimer;
+    if (showStats_) {
+        stats_.beginFrame();
+        frameTimer.start();
+        layerTimer.start();
+    }
+    auto endLayer = [&](RenderStats::Layer layer) {
+        if (!showStats_) return;
+        stats_.addLayerTime(layer, layerTimer.nsecsElapsed());
+        layerTimer.restart();
+    };
+
+    /* 内容缓存：窗口大小或缩放比例改变时整体重绘；平移时移动已有的像素，只重绘新露出的部分 */
+    const qreal dpr = cachePixelRatio();
+    const QSize cacheSize = (QSizeF(size()) * dpr).toSize();
+    if (content_.pixmap.size() != cacheSize || content_.pixmap.devicePixelRatio() != dpr) {
+        cancelRender();
+        renderPending_ = QRegion();
+        if (spareContent_.pixmap.size() == cacheSize && spareContent_.pixmap.devicePixelRatio() == dpr) {
+            // 窗口移回了上一个屏幕：换回按它的像素比绘制的缓存，其中仍然有效的部分不必重画
+            std::swap(content_, spareContent_);
+        } else {
+            // 换到像素比不同的屏幕时，原来的缓存留作备用（两份缓存的总内存不超过预算时）
+            const bool keep = !content_.pixmap.isNull() && content_.pixmap.devicePixelRatio() != dpr &&
+                              pixmapBytes(content_.pixmap.size()) + pixmapBytes(cacheSize) <= cacheBudget_;
+            spareContent_ = keep ? std::move(content_) : ContentCache();
+            content_ = ContentCache();
+            content_.pixmap = QPixmap(cacheSize);
+            content_.pixmap.setDevicePixelRatio(dpr);
+            content_.dirty = rect();
+        }
+    }
+    // 新建或换回的缓存同样要对照当前的缩放比例和偏移量
+    if (content_.scale != scale_) {
+        cancelRender();
+        content_.dirty = rect();
+        content_.fast = QRegion();
+        renderPending_ = QRegion();   // 缩放后由逐块重绘决定先画哪里
+    } else if (content_.offset != viewOffset_) {
+        cancelRender();
+        const QPointF shift = viewOffset_ - content_.offset;
+        const QPointF deviceShift = shift * dpr;
+        if (shift == QPointF(shift.toPoint()) && deviceShift == QPointF(deviceShift.toPoint()) &&
+            qAbs(shift.x()) < width() && qAbs(shift.y()) < height()) {
+            const QPoint d = shift.toPoint();
+            content_.pixmap.scroll(deviceShift.toPoint().x(), deviceShift.toPoint().y(), content_.pixmap.rect());
+            const QRegion uncovered = QRegion(rect()) - QRegion(rect().translated(d));
+            content_.dirty.translate(d);
+            content_.dirty = (content_.dirty & rect()) + uncovered;
+            content_.fast.translate(d);
+            content_.fast &= rect();
+            renderPending_.translate(d);
+            renderPending_ &= rect();
+        } else {
+            content_.dirty = rect();
+            content_.fast = QRegion();
+            renderPending_ = QRegion();
+        }
+    }
+    content_.scale = scale_;
+    content_.offset = viewOffset_;
+    // 快速绘制留在缓存中的部分，在完整画质的一帧中重画
+    if (!fast) content_.dirty += content_.fast;
+
+    // 只重绘本次需要显示、且缓存中已经过期的部分；其余的过期部分留到它们需要显示时再画
+    // （包括之前被打断或推迟的部分）
+    const QRect exposed = event->rect();
+    const QRegion stale = content_.dirty & (event->region() + renderPending_);
+    int shapesDrawn = 0;
+    int connectorsDrawn = 0;
+    if (job_.active) {
+        // 上一次的分片绘制还没有完成，新的过期部分等它完成后再画
+        renderPending_ += stale - job_.region;
+    } else {
+        renderPending_ = QRegion();   // 推迟的部分都包含在 stale 中
+    }
+    if (!job_.active && !stale.isEmpty()) {
+        // 第一片在这里画；超出预算时剩下的交给事件循环，先显示已经画好的部分
+        startRender(stale, lod, fast);
+        shapesDrawn = job_.shapesDrawn;
+        connectorsDrawn = job_.connectorsDrawn;
+        if (showStats_) layerTimer.restart();
+        // 本次没有显示的部分已经画好，另外贴出来
+        const QRegion outside = stale - event->region();
+        if (!job_.active && !outside.isEmpty()) update(outside.boundingRect());
+    }
+    span.arg("shapes", static_cast<int>(doc_.shapes.size()))
+        .arg("shapesDrawn", shapesDrawn)
+        .arg("connectorsDrawn", connectorsDrawn)
+        .arg("scale", static_cast<double>(scale_))
+        .arg("fast", fast)
+        .arg("cached", stale.isEmpty())
+        .arg("sliced", job_.active);
+
+    // 把缓存贴到窗口上
+    p.drawPixmap(exposed, content_.pixmap, QRectF(QPointF(exposed.topLeft()) * dpr, QSizeF(exposed.size()) * dpr));
+    endLayer(RenderStats::Background);
+
+    /* 覆盖层：悬停高亮、正在绘制的连接线、选中框和调整大小的控制柄，不进入内容缓存 */
+    if (!fast) p.setRenderHint(QPainter::Antialiasing);
+    if (!doc_.isUnbounded()) {
+        p.setClipRect(QRectF(docToView(QPointF(0, 0)),
+                             docToView(QPointF(doc_.pageSize.width(), doc_.pageSize.height()))));
+    }
     p.save();
     p.translate(viewOffset_);
     p.scale(scale_, scale_);
 
-    /* 网格 */
-    if (showGrid_) {
-        const int step = 20;
-        p.setPen(QColor(220, 220, 220));
-        
-        // 计算网格的起始和结束位置
-        int startX = 0;
-        int startY = 0;
-        int endX = pageSize_.width();
-        int endY = pageSize_.height();
-        
-        for (int x = startX; x <= endX; x += step) 
-            p.drawLine(x, startY, x, endY);
-        for (int y = startY; y <= endY; y += step) 
-            p.drawLine(startX, y, endX, y);
+    if (hoverIndex_ >= 0 && hoverIndex_ < doc_.shapes.size() && hoverIndex_ != selectedIndex_) {
+        QPen hoverPen(QColor(0, 120, 215, 160), 2);
+        hoverPen.setCosmetic(true);
+        p.setPen(hoverPen);
+        p.setBrush(Qt::NoBrush);
+        p.drawRect(doc_.shapes[hoverIndex_]->bounds.normalized().adjusted(-2, -2, 2, 2));
+    }
+    /* 拖动中的图形：连接线按当前位置重画，图形直接贴上拖动开始时画好的图 */
+    if (const Shape* dragged = draggedShape()) {
+        for (const Connector& c : doc_.connectors) {
+            if (c.src == dragged || c.dst == dragged) c.paint(p);
+        }
+        if (dragSpriteScale_ == scale_ && dragSprite_.devicePixelRatio() == devicePixelRatioF()) {
+            const QPointF pos = docToView(dragged->bounds.topLeft() + dragSpriteOffset_);
+            p.save();
+            p.resetTransform();
+            p.drawPixmap(pos, dragSprite_);
+            p.restore();
+        } else {
+            dragged->paint(p, false);   // 拖动中途缩放过或换了屏幕，图已不适用
+        }
     }
-
-    /* 连接线（先画连接线再画图形） */
-    for (const auto& c : connectors_) c.paint(p);
     if (currentConn_.src) currentConn_.paint(p);
 
-    /* 图形 */
-    for (int i = 0; i < shapes_.size(); ++i)
-        shapes_[i]->paint(p, i == selectedIndex_);
-    
-    /* 如果有选中的元素，绘制调整大小的控制柄 */
-    if (selectedIndex_ >= 0 && selectedIndex_ < shapes_.size()) {
-        drawResizeHandles(p, shapes_[selectedIndex_]->bounds);
+    /* 如果有选中的元素，绘制选中框和调整大小的控制柄 */
+    if (selectedIndex_ >= 0 && selectedIndex_ < doc_.shapes.size()) {
+        const Shape* selected = doc_.shapes[selectedIndex_];
+        selected->paintSelection(p);
+        drawResizeHandles(p, selected->bounds);
     }
+    endLayer(RenderStats::Handles);
         
     p.restore();
+
+    lastFrameFast_ = fast;
+
+    // 本帧已反映此前的所有输入：分片绘制还没画完、或有推迟的部分时，
+    // 窗口中仍有过期的内容，等画完最后一片之后的那一帧再算
+    if (!job_.active && renderPending_.isEmpty()) latency_.frameCompleted();
+
+    /* 渲染统计面板（不受页面剪裁影响；截取缩放预览画面时不画） */
+    if (showStats_ && !grabbingFrame_) {
+        RenderStats::DocInfo info;
+        info.shapesDrawn = shapesDrawn;
+        info.shapesTotal = static_cast<int>(doc_.shapes.size());
+        info.connectorsDrawn = connectorsDrawn;
+        info.connectorsTotal = static_cast<int>(doc_.connectors.size());
+        info.undoDepth = doc_.undoDepth();
+        info.historyBytes = doc_.historyBytes();
+        stats_.endFrame(frameTimer.nsecsElapsed(), info);
+
+        QStringList latencyLines = latency_.summaryLines();
+        if (!latencyLines.isEmpty())
+            latencyLines.prepend(QString("latency      p50   p95   p99"));
+
+        p.setClipping(false);
+        stats_.draw(p, QPoint(8, 8), latencyLines);
+    }
+}
+
+void FlowView::invalidateContent()
+{
+    cancelRender();
+    content_.dirty = rect();
+    spareContent_.scale = 0;   // 备用缓存换回时整体重绘
+    hoverIndex_ = -1;   // 图形可能已被删除或改变了顺序
+    // 整个缓存重画时拖动中的图形也画进去，继续拖动时重新冻结背景
+    dragging_ = false;
+    dragIndex_ = -1;
+    dragSprite_ = QPixmap();
+    update();
+}
+
+void FlowView::invalidateContent(const QRectF& docRect)
+{
+    cancelRender();   // 正在绘制的部分可能已经画了改变前的内容
+    // 缓存还没有按当前的视图变换重绘时，区域无法换算到缓存中
+    if (content_.scale != scale_ || content_.offset != viewOffset_) {
+        content_.dirty = rect();
+    } else {
+        const QRectF r(docToView(docRect.topLeft()), docToView(docRect.bottomRight()));
+        content_.dirty += r.toAlignedRect().adjusted(-1, -1, 1, 1) & rect();
+    }
+    if (spareContent_.scale != 0) {
+        // 备用缓存按它自己的缩放比例和偏移量换算
+        const QRectF r(docRect.topLeft() * spareContent_.scale + spareContent_.offset,
+                       docRect.size() * spareContent_.scale);
+        spareContent_.dirty += r.toAlignedRect().adjusted(-1, -1, 1, 1);
+    }
+    update();   // 覆盖层可能在任何位置，整个窗口都要重新贴图
+}
+
+const Shape* FlowView::draggedShape() const
+{
+    return dragging_ && dragIndex_ >= 0 && dragIndex_ < doc_.shapes.size() ? doc_.shapes[dragIndex_] : nullptr;
+}
+
+void FlowView::startRender(const QRegion& region, const LodOptions& lod, bool fast)
+{
+    job_ = RenderJob();
+    job_.active = true;
+    job_.region = region;
+    job_.lod = lod;
+    job_.fast = fast;
+
+    QElapsedTimer timer;
+    timer.start();
+    QPainter cp(&content_.pixmap);
+    cp.setClipRegion(region);
+    const QRect area = region.boundingRect();
+
+    // 背景和网格一次画完，之后的每一片只画连接线和图形
+    if (doc_.isUnbounded()) {
+        // 无边界画布：可见区域全部是文档背景，不画页面边框也不剪裁
+        cp.fillRect(area, doc_.backgroundColor);
+        job_.clip = region;
+    } else {
+        // 填充窗口背景
+        cp.fillRect(area, QColor("#f0f0f0")); // 灰色的窗口背景
+
+        // 绘制页面边界和背景
+        drawPageBorder(cp);
+
+        // 只在页面内绘制
+        QRectF pageRect = QRectF(docToView(QPointF(0, 0)),
+                                 docToView(QPointF(doc_.pageSize.width(), doc_.pageSize.height())));
+        job_.clip = region & pageRect.toAlignedRect();
+    }
+    if (showStats_) stats_.addLayerTime(RenderStats::Background, timer.nsecsElapsed());
+
+    /* 网格：只绘制需要重绘的区域（平移时只有新露出的部分） */
+    qint64 mark = timer.nsecsElapsed();
+    job_.visibleDoc = visibleDocRect().intersected(QRectF(viewToDoc(area.topLeft()),
+                                                          viewToDoc(area.bottomRight() + QPoint(1, 1))));
+    if (doc_.showGrid) {
+        cp.setClipRegion(job_.clip);
+        cp.translate(viewOffset_);
+        cp.scale(scale_, scale_);
+        doc_.drawGrid(cp, job_.visibleDoc);
+    }
+    if (showStats_) stats_.addLayerTime(RenderStats::Grid, timer.nsecsElapsed() - mark);
+    cp.end();
+
+    job_.elapsedNs = timer.nsecsElapsed();
+    if (!renderSlice(SliceBudgetNs - job_.elapsedNs)) {
+        sliceTimer_.start();
+    }
+}
+
+bool FlowView::renderSlice(qint64 budgetNs)
+{
+    TraceSpan span("FlowView::renderSlice", "paint");
+    QElapsedTimer timer;
+    timer.start();
+
+    QPainter cp(&content_.pixmap);
+    cp.setClipRegion(job_.clip);
+    if (!job_.fast) cp.setRenderHint(QPainter::Antialiasing);
+    cp.translate(viewOffset_);
+    cp.scale(scale_, scale_);
+
+    // 拖动中的图形和它的连接线不进入缓存，在覆盖层中绘制
+    const Shape* dragged = draggedShape();
+
+    /* 连接线（先画连接线再画图形），按层级顺序逐段绘制，每段之后检查时间 */
+    int connectors = 0;
+    const int connectorCount = doc_.connectors.size();
+    while (job_.nextConnector < connectorCount && timer.nsecsElapsed() < budgetNs) {
+        const int last = qMin(connectorCount, job_.nextConnector + SliceItems);
+        connectors += doc_.drawConnectorRange(cp, job_.nextConnector, last, job_.visibleDoc, job_.lod, dragged);
+        job_.nextConnector = last;
+    }
+    const qint64 connectorsNs = timer.nsecsElapsed();
+
+    /* 图形（选中框在覆盖层中绘制） */
+    int shapes = 0;
+    const int shapeCount = doc_.shapes.size();
+    while (job_.nextConnector >= connectorCount && job_.nextShape < shapeCount &&
+           timer.nsecsElapsed() < budgetNs) {
+        const int last = qMin(shapeCount, job_.nextShape + SliceItems);
+        shapes += doc_.drawShapeRange(cp, job_.nextShape, last, -1, job_.visibleDoc, job_.lod, dragged);
+        job_.nextShape = last;
+    }
+    cp.end();
+
+    if (showStats_) {
+        stats_.addLayerTime(RenderStats::Connectors, connectorsNs);
+        stats_.addLayerTime(RenderStats::Shapes, timer.nsecsElapsed() - connectorsNs);
+    }
+    job_.connectorsDrawn += connectors;
+    job_.shapesDrawn += shapes;
+    job_.elapsedNs += timer.nsecsElapsed();
+    span.arg("shapesDrawn", shapes).arg("connectorsDrawn", connectors)
+        .arg("nextShape", job_.nextShape).arg("shapes", shapeCount);
+
+    if (job_.nextConnector < connectorCount || job_.nextShape < shapeCount) return false;
+
+    // 全部画完
+    job_.active = false;
+    sliceTimer_.stop();
+    content_.dirty -= job_.region;
+    if (job_.fast) {
+        content_.fast += job_.region;
+    } else {
+        content_.fast -= job_.region;
+        // 只有整个画面都重新绘制才能代表完整画质一帧的耗时
+        if (job_.region.boundingRect() == rect()) fullFrameNs_ = job_.elapsedNs;
+    }
+    return true;
+}
+
+void FlowView::continueRender()
+{
+    if (!job_.active) {
+        sliceTimer_.stop();
+        return;
+    }
+    // 视图已经平移或缩放，缓存还没有随之更新：放弃，等下一帧按新的视图重新开始
+    if (content_.scale != scale_ || content_.offset != viewOffset_) {
+        cancelRender();
+        return;
+    }
+    const QRect area = job_.region.boundingRect();
+    if (renderSlice(SliceBudgetNs)) {
+        // 绘制期间需要显示的其他过期部分
+        renderPending_ &= content_.dirty;
+        if (!renderPending_.isEmpty()) update(renderPending_.boundingRect());
+    }
+    update(area);   // 显示已经画好的部分
+}
+
+void FlowView::cancelRender()
+{
+    // 已经画了一部分的区域仍然是过期的，下一帧重新开始
+    if (job_.active) {
+        renderPending_ += job_.region;
+        update(job_.region.boundingRect());
+    }
+    job_.active = false;
+    sliceTimer_.stop();
+}
+
+QRectF FlowView::dragArea(const Shape* shape) const
+{
+    // 图形和连在它上面的连接线（连接线总在两端图形的外接矩形内）
+    QRectF area = shape->bounds.normalized();
+    for (const Connector& c : doc_.connectors) {
+        if ((c.src == shape || c.dst == shape) && c.src && c.dst) {
+            area |= c.src->bounds.normalized() | c.dst->bounds.normalized();
+        }
+    }
+    const qreal margin = DragMargin + shape->strokeWidth();
+    return area.adjusted(-margin, -margin, margin, margin);
+}
+
+void FlowView::beginDrag()
+{
+    const Shape* s = doc_.shapes[selectedIndex_];
+    dragging_ = true;
+    dragIndex_ = selectedIndex_;
+
+    // 从缓存中去掉拖动的图形和它的连接线，拖动期间不再重绘缓存
+    invalidateContent(dragArea(s));
+
+    // 把图形画成一张图，拖动时只需平移贴图
+    const qreal dpr = devicePixelRatioF();
+    const qreal margin = s->strokeWidth() + 2;
+    const QRectF docRect = s->bounds.normalized().adjusted(-margin, -margin, margin, margin);
+    dragSprite_ = QPixmap((docRect.size() * scale_ * dpr).toSize().expandedTo(QSize(1, 1)));
+    dragSprite_.setDevicePixelRatio(dpr);
+    dragSprite_.fill(Qt::transparent);
+    QPainter sp(&dragSprite_);
+    sp.setRenderHint(QPainter::Antialiasing);
+    sp.scale(scale_, scale_);
+    sp.translate(-docRect.topLeft());
+    s->paint(sp, false);
+    dragSpriteOffset_ = docRect.topLeft() - s->bounds.topLeft();
+    dragSpriteScale_ = scale_;
+}
+
+void FlowView::endDrag()
+{
+    // 图形画回缓存：只重绘它现在所在的区域，原来的位置在拖动开始时已经画成背景
+    const int index = dragIndex_;
+    dragging_ = false;
+    dragIndex_ = -1;
+    dragSprite_ = QPixmap();
+    if (index >= 0 && index < doc_.shapes.size()) {
+        invalidateContent(dragArea(doc_.shapes[index]));
+    } else {
+        invalidateContent();
+    }
+}
+
+void FlowView::leaveEvent(QEvent* event)
+{
+    QWidget::leaveEvent(event);
+    if (hoverIndex_ != -1) {
+        hoverIndex_ = -1;
+        update();
+    }
+}
+
+// 显示或隐藏渲染统计面板
+void FlowView::setStatsOverlayVisible(bool visible)
+{
+    showStats_ = visible;
+    update();
+}
+
+void FlowView::beginGesture()
+{
+    gestureActive_ = true;
+    gestureIdleTimer_.start();
+
+    // 逐块重绘还没完成时，剩下的块留到手势结束后整体重绘
+    if (!tiles_.empty()) {
+        tiles_.clear();
+        tileTimer_.stop();
+        staleFrame_ = true;
+    }
+}
+
+void FlowView::endGesture()
+{
+    gestureActive_ = false;
+    if (!zoomFrame_.isNull()) {
+        // 缩放结束：按新的比例逐块重绘，先画光标附近的块，其余的块暂时保留缩放后的预览
+        zoomFrame_ = QPixmap();
+        startTiles(zoomAnchor_);
+        return;
+    }
+    if (lastFrameFast_ || staleFrame_) {   // 补画一帧完整画质
+        staleFrame_ = false;
+        update();
+    }
+}
+
+void FlowView::zoomAt(qreal factor, const QPointF& anchor)
+{
+    // 手势开始时截取当前画面，之后的每一步只缩放这张图
+    if (zoomFrame_.isNull()) {
+        grabbingFrame_ = true;
+        zoomFrame_ = grab();
+        grabbingFrame_ = false;
+        zoomFrameScale_ = scale_;
+        zoomFrameOffset_ = viewOffset_;
+    }
+
+    // 缩放后光标下的文档位置保持不动
+    const QPointF docAnchor = viewToDoc(anchor);
+    scale_ = qBound(0.1, scale_ * factor, 5.0);
+    viewOffset_ = anchor - docAnchor * scale_;
+    zoomAnchor_ = anchor.toPoint();
+    update();
+    emit viewChanged();
+}
+
+void FlowView::startTiles(const QPoint& anchor)
+{
+    tiles_.clear();
+    for (int y = 0; y < height(); y += TileSize) {
+        for (int x = 0; x < width(); x += TileSize) {
+            tiles_.push_back(QRect(x, y, TileSize, TileSize).intersected(rect()));
+        }
+    }
+    // 按到 anchor 的距离排序，最后取出的是最近的块
+    auto distance = [&anchor](const QRect& r) { return (r.center() - anchor).manhattanLength(); };
+    std::sort(tiles_.begin(), tiles_.end(), [&distance](const QRect& a, const QRect& b) {
+        return distance(a) > distance(b);
+    });
+    staleFrame_ = false;
+    tileTimer_.start();
+}
+
+void FlowView::renderTiles()
+{
+    /* 块按顺序交给分片绘制：每次事件循环只开始一块，由分片绘制控制每片的时间；
+       上一块还没画完时等它完成，保持近处的块先画 */
+    if (job_.active) return;
+    TraceSpan span("FlowView::renderTiles", "paint");
+    const bool current = content_.scale == scale_ && content_.offset == viewOffset_;
+    while (!tiles_.empty()) {
+        const QRect tile = tiles_.back();
+        tiles_.pop_back();
+        // 已经随其他部分画好的块跳过（缓存还没按当前视图更新时都要画）
+        if (current && !content_.dirty.intersects(tile)) continue;
+        repaint(tile);
+        break;
+    }
+    span.arg("remaining", static_cast<int>(tiles_.size()));
+    if (tiles_.empty()) tileTimer_.stop();
+}
+
+LodOptions FlowView::lodSettings()
+{
+    QSettings s;
+    LodOptions lod;
+    lod.enabled = s.value("lod/enabled", true).toBool();
+    lod.textPixels = s.value("lod/textPixels", lod.textPixels).toDouble();
+    lod.shapePixels = s.value("lod/shapePixels", lod.shapePixels).toDouble();
+    lod.pointPixels = s.value("lod/pointPixels", lod.pointPixels).toDouble();
+    lod.arrowPixels = s.value("lod/arrowPixels", lod.arrowPixels).toDouble();
+    return lod;
+}
+
+qint64 FlowView::cacheBudgetBytes()
+{
+    return qint64(QSettings().value("cache/budgetMB", DefaultCacheBudgetMB).toInt()) * 1024 * 1024;
+}
+
+qreal FlowView::cachePixelRatio() const
+{
+    // 缓存按屏幕的设备像素比绘制；窗口太大超出内存预算时降低缓存的分辨率（不低于 1）
+    const qreal dpr = devicePixelRatioF();
+    const qreal fit = std::sqrt(qreal(cacheBudget_) / pixmapBytes(size().expandedTo(QSize(1, 1))));
+    return qMax<qreal>(1.0, qMin(dpr, std::floor(fit * 4) / 4));
+}
+
+void FlowView::setLevelOfDetail(const LodOptions& lod)
+{
+    QSettings s;
+    s.setValue("lod/enabled", lod.enabled);
+    s.setValue("lod/textPixels", lod.textPixels);
+    s.setValue("lod/shapePixels", lod.shapePixels);
+    s.setValue("lod/pointPixels", lod.pointPixels);
+    s.setValue("lod/arrowPixels", lod.arrowPixels);
+    lod_ = lod;
+    invalidateContent();
+}
+
+// 自顶向下查找命中的图形（跳过 exclude），返回索引，未命中返回 -1
+int FlowView::hitTestShape(const QPointF& docPos, const Shape* exclude) const
+{
+    TraceSpan span("FlowView::hitTestShape", "input");
+    int tested = 0;
+    int hit = -1;
+    for (int i = static_cast<int>(doc_.shapes.size()) - 1; i >= 0; --i) {
+        const Shape* s = doc_.shapes[i];
+        if (s == exclude) continue;
+        ++tested;
+        if (s->hitTest(docPos)) {
+            hit = i;
+            break;
+        }
+    }
+    stats_.countHitTests(tested);
+    span.arg("tested", tested).arg("hit", hit);
+    return hit;
 }
 
 /* ======= ¼ ======= */
 void FlowView::mousePressEvent(QMouseEvent* event)
 {
+    TraceSpan span("FlowView::mousePressEvent", "input");
     setFocus(); // 获取焦点，以便接收键盘事件
     
     if (isPanning_) {
@@ -106,12 +713,14 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         }
     }
 
+    // 加载期间只能平移浏览
+    if (loading_) return;
+
     // 将视图坐标转换为文档坐标
     QPointF docPos = viewToDoc(event->pos());
     
     // 检查点击位置是否在页面内
-    if (docPos.x() < 0 || docPos.y() < 0 || 
-        docPos.x() > pageSize_.width() || docPos.y() > pageSize_.height()) {
+    if (!isOnPage(docPos)) {
         return;
     }
 
@@ -122,8 +731,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto r = std::make_unique<Rect>();
         r->bounds.setTopLeft(docPos);
         r->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(r));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(r));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -131,8 +740,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto el = std::make_unique<Ellipse>();
         el->bounds.setTopLeft(docPos);
         el->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(el));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(el));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -140,8 +749,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto diamond = std::make_unique<Diamond>();
         diamond->bounds.setTopLeft(docPos);
         diamond->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(diamond));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(diamond));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -149,8 +758,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto triangle = std::make_unique<Triangle>();
         triangle->bounds.setTopLeft(docPos);
         triangle->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(triangle));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(triangle));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -158,8 +767,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto pentagon = std::make_unique<Pentagon>();
         pentagon->bounds.setTopLeft(docPos);
         pentagon->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(pentagon));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(pentagon));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -167,8 +776,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto hexagon = std::make_unique<Hexagon>();
         hexagon->bounds.setTopLeft(docPos);
         hexagon->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(hexagon));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(hexagon));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -176,8 +785,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto octagon = std::make_unique<Octagon>();
         octagon->bounds.setTopLeft(docPos);
         octagon->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(octagon));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(octagon));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -185,8 +794,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto roundedRect = std::make_unique<RoundedRect>();
         roundedRect->bounds.setTopLeft(docPos);
         roundedRect->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(roundedRect));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(roundedRect));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -194,8 +803,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto capsule = std::make_unique<Capsule>();
         capsule->bounds.setTopLeft(docPos);
         capsule->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(capsule));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(capsule));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -203,8 +812,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         auto rectTriangle = std::make_unique<RectTriangle>();
         rectTriangle->bounds.setTopLeft(docPos);
         rectTriangle->bounds.setBottomRight(docPos);
-        shapes_.push_back(std::move(rectTriangle));
-        selectedIndex_ = int(shapes_.size()) - 1;
+        doc_.shapes.push_back(std::move(rectTriangle));
+        selectedIndex_ = int(doc_.shapes.size()) - 1;
         dragStart_ = docPos;
         return;
     }
@@ -214,23 +823,22 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         // 如果当前已经有一个连接线起点，则尝试完成连接
         if (currentConn_.src) {
             // 检查是否点击到了作为终点的形状
-            for (int i = shapes_.size() - 1; i >= 0; --i) {
-                if (shapes_[i].get() != currentConn_.src && shapes_[i]->hitTest(docPos)) {
-                    // 找到终点形状，创建连接线
-                    currentConn_.dst = shapes_[i].get();
-                    connectors_.push_back(currentConn_);
-                    
-                    // 重置当前连接线
-                    currentConn_ = Connector{};
-                    
-                    // 完成连线后，自动退出连接器模式
-                    mode_ = ToolMode::None;
-                    setCursor(Qt::ArrowCursor);
-                    
-                    // 更新视图
-                    update();
-                    return;
-                }
+            int i = hitTestShape(docPos, currentConn_.src);
+            if (i != -1) {
+                // 找到终点形状，创建连接线
+                currentConn_.dst = doc_.shapes[i];
+                doc_.connectors.push_back(currentConn_);
+                
+                // 重置当前连接线
+                currentConn_ = Connector{};
+                
+                // 完成连线后，自动退出连接器模式
+                mode_ = ToolMode::None;
+                setCursor(Qt::ArrowCursor);
+                
+                // 更新视图
+                invalidateContent();
+                return;
             }
             
             // 如果点击空白处或同一个形状，取消当前连接线
@@ -240,31 +848,24 @@ void FlowView::mousePressEvent(QMouseEvent* event)
         }
         
         // 检查是否点击了已有图形作为连线起点
-        for (int i = shapes_.size() - 1; i >= 0; --i) {
-            if (shapes_[i]->hitTest(docPos)) {
-                currentConn_.src = shapes_[i].get();
-                currentConn_.tempEnd = docPos;   // temporary pointer position
-                update();
-                return;
-            }
+        int srcIndex = hitTestShape(docPos);
+        if (srcIndex != -1) {
+            currentConn_.src = doc_.shapes[srcIndex];
+            currentConn_.tempEnd = docPos;   // temporary pointer position
+            update();
+            return;
         }
         
         // 如果没有点击到任何形状，但处于连接器模式，尝试以选择操作处理
         if (mode_ == ToolMode::DrawConnector) {
             // 尝试选择模式的行为
-            int newSelectedIndex = -1;
-            for (int i = shapes_.size() - 1; i >= 0; --i) {
-                if (shapes_[i]->hitTest(docPos)) {
-                    newSelectedIndex = i;
-                    break;
-                }
-            }
+            int newSelectedIndex = hitTestShape(docPos);
             
             if (newSelectedIndex != -1) {
                 // 点击到了形状，但没有开始连线，切换回选择模式
                 selectedIndex_ = newSelectedIndex;
-                auto* s = shapes_[selectedIndex_].get();
-                emit shapeAttr(s->fillColor, s->strokeColor, s->strokeWidth);
+                const Shape* s = doc_.shapes[selectedIndex_];
+                emit shapeAttr(s->fillColor(), s->strokeColor(), s->strokeWidth());
                 updatePropertyPanel();
                 
                 // 切换回选择模式
@@ -278,11 +879,11 @@ void FlowView::mousePressEvent(QMouseEvent* event)
 
     /* --- 3. 检查是否点击了调整柄 --- */
     if (selectedIndex_ != -1 && mode_ == ToolMode::None) {
-        resizeHandle_ = hitTestResizeHandles(docPos, shapes_[selectedIndex_]->bounds);
+        resizeHandle_ = hitTestResizeHandles(docPos, doc_.shapes[selectedIndex_]->bounds);
         if (resizeHandle_ != ResizeHandle::None) {
             dragStart_ = docPos;
             // 保存调整大小前的状态
-            lastShapeState_ = shapes_[selectedIndex_]->toJson();
+            lastShapeState_ = doc_.shapes[selectedIndex_]->toJson();
             event->accept();
             return;
         }
@@ -293,14 +894,11 @@ void FlowView::mousePressEvent(QMouseEvent* event)
     selectedConnectorIndex_ = -1;
     
     // 优先检查图形，然后才是连接线，反转原来的选择顺序
-    for (int i = shapes_.size() - 1; i >= 0; --i) {
-        if (shapes_[i]->hitTest(docPos)) {
-            selectedIndex_ = i;
-            dragStart_ = docPos;
-            // 保存移动前的状态
-            lastShapeState_ = shapes_[i]->toJson();
-            break;
-        }
+    selectedIndex_ = hitTestShape(docPos);
+    if (selectedIndex_ != -1) {
+        dragStart_ = docPos;
+        // 保存移动前的状态
+        lastShapeState_ = doc_.shapes[selectedIndex_]->toJson();
     }
     
     // 如果没有选中图形，再尝试选择连接线
@@ -309,8 +907,8 @@ void FlowView::mousePressEvent(QMouseEvent* event)
     }
     
     if (selectedIndex_ != -1) {
-        auto* s = shapes_[selectedIndex_].get();
-        emit shapeAttr(s->fillColor, s->strokeColor, s->strokeWidth);
+        const Shape* s = doc_.shapes[selectedIndex_];
+        emit shapeAttr(s->fillColor(), s->strokeColor(), s->strokeWidth());
         // 更新属性面板，包括尺寸
         updatePropertyPanel();
     }
@@ -340,11 +938,14 @@ void FlowView::mousePressEvent(QMouseEvent* event)
 
 void FlowView::mouseMoveEvent(QMouseEvent* event)
 {
+    TraceSpan span("FlowView::mouseMoveEvent", "input");
+    const qint64 arrival = latency_.now();
     if (isPanning_ && (event->buttons() & Qt::LeftButton)) {
         // 平移视图
-        viewOffset_ += event->pos() - lastPanPoint_;
+        latency_.markInput(LatencyTracker::Pan, arrival);
+        beginGesture();
+        panBy(event->pos() - lastPanPoint_);
         lastPanPoint_ = event->pos();
-        update();
         return;
     }
     
@@ -358,10 +959,12 @@ void FlowView::mouseMoveEvent(QMouseEvent* event)
         QPointF offset = docPos - dragStart_;
         dragStart_ = docPos;
         
-        resizeRect(shapes_[selectedIndex_]->bounds, resizeHandle_, offset);
-        updateConnectorsFor(shapes_[selectedIndex_].get());
+        latency_.markInput(LatencyTracker::Resize, arrival);
+        beginGesture();
+        resizeRect(doc_.editShape(selectedIndex_)->bounds, resizeHandle_, offset);
+        updateConnectorsFor(doc_.shapes[selectedIndex_]);
         updatePropertyPanel();  // 更新尺寸属性面板
-        update();
+        invalidateContent();
         return;
     }
 
@@ -372,25 +975,22 @@ void FlowView::mouseMoveEvent(QMouseEvent* event)
          mode_ == ToolMode::DrawRectTriangle) &&
         selectedIndex_ != -1 && (event->buttons() & Qt::LeftButton))
     {
-        auto& r = shapes_[selectedIndex_]->bounds;
-        r.setBottomRight(docPos);
-        update();
+        latency_.markInput(LatencyTracker::Resize, arrival);
+        beginGesture();
+        doc_.editShape(selectedIndex_)->bounds.setBottomRight(docPos);
+        invalidateContent();
         return;
     }
 
     /* --- 2. 连接线拖拽 --- */
     if (mode_ == ToolMode::DrawConnector && currentConn_.src)
     {
+        latency_.markInput(LatencyTracker::Connector, arrival);
         currentConn_.tempEnd = docPos;
                 
         // 查找终点是否落在任何图形上
-        Shape* hitShape = nullptr;
-        for (int i = shapes_.size() - 1; i >= 0; --i) {
-            if (shapes_[i].get() != currentConn_.src && shapes_[i]->hitTest(docPos)) {
-                hitShape = shapes_[i].get();
-                break;
-            }
-        }
+        int hitIndex = hitTestShape(docPos, currentConn_.src);
+        const Shape* hitShape = hitIndex != -1 ? doc_.shapes[hitIndex] : nullptr;
         
         // 当鼠标悬停在可连接的目标形状上时，改变光标样式提示用户
         if (hitShape) {
@@ -412,15 +1012,18 @@ void FlowView::mouseMoveEvent(QMouseEvent* event)
         QPointF delta = docPos - dragStart_;
         dragStart_ = docPos;
         
-        shapes_[selectedIndex_]->bounds.translate(delta);
-        updateConnectorsFor(shapes_[selectedIndex_].get());
-        update();
+        latency_.markInput(LatencyTracker::Drag, arrival);
+        beginGesture();
+        if (!dragging_) beginDrag();
+        doc_.editShape(selectedIndex_)->bounds.translate(delta);
+        updateConnectorsFor(doc_.shapes[selectedIndex_]);
+        update();   // 背景已冻结在缓存中，只重画覆盖层
         return;
     }
     
     /* --- 4. 悬停时显示合适的鼠标指针 --- */
     if (selectedIndex_ != -1 && mode_ == ToolMode::None) {
-        ResizeHandle hitHandle = hitTestResizeHandles(docPos, shapes_[selectedIndex_]->bounds);
+        ResizeHandle hitHandle = hitTestResizeHandles(docPos, doc_.shapes[selectedIndex_]->bounds);
         
         if (hitHandle != ResizeHandle::None) {
             // 根据调整柄类型设置不同的鼠标指针形状
@@ -454,12 +1057,14 @@ void FlowView::mouseMoveEvent(QMouseEvent* event)
     }
     
     // 检查是否悬停在任何图形上
-    bool hitAnyShape = false;
-    for (int i = shapes_.size() - 1; i >= 0; --i) {
-        if (shapes_[i]->hitTest(docPos)) {
-            hitAnyShape = true;
-            break;
-        }
+    const int hoverIndex = hitTestShape(docPos);
+    bool hitAnyShape = hoverIndex != -1;
+
+    // 悬停高亮画在覆盖层中，改变时不需要重绘内容
+    const int hover = mode_ == ToolMode::None ? hoverIndex : -1;
+    if (hover != hoverIndex_) {
+        hoverIndex_ = hover;
+        update();
     }
     
     // 如果是平移模式，保持OpenHandCursor
@@ -492,18 +1097,15 @@ void FlowView::mouseReleaseEvent(QMouseEvent* event)
         if (currentConn_.dst)
         {
             // 保存当前连接线的源和目标索引
-            int srcIndex = -1, dstIndex = -1;
-            for (size_t i = 0; i < shapes_.size(); ++i) {
-                if (shapes_[i].get() == currentConn_.src) srcIndex = i;
-                if (shapes_[i].get() == currentConn_.dst) dstIndex = i;
-            }
+            int srcIndex = doc_.indexOf(currentConn_.src);
+            int dstIndex = doc_.indexOf(currentConn_.dst);
             
             // 添加连接线
-            connectors_.push_back(currentConn_);
-            int connIndex = connectors_.size() - 1;
+            doc_.connectors.push_back(currentConn_);
+            int connIndex = doc_.connectors.size() - 1;
             
             // 记录连接线创建历史
-            recordConnectorAction(ActionType::AddConn, connIndex, srcIndex, dstIndex);
+            doc_.recordConnectorAction(ActionType::AddConn, connIndex, srcIndex, dstIndex);
             
             // 重置当前连接线
             currentConn_ = Connector{};
@@ -518,7 +1120,7 @@ void FlowView::mouseReleaseEvent(QMouseEvent* event)
             currentConn_ = Connector{};
         }
         
-        update();
+        invalidateContent();
         return;
     }
     
@@ -529,10 +1131,10 @@ void FlowView::mouseReleaseEvent(QMouseEvent* event)
          mode_ == ToolMode::DrawRectTriangle) && 
         selectedIndex_ != -1 && event->button() == Qt::LeftButton)
     {
-        auto& r = shapes_[selectedIndex_]->bounds;
+        QRectF& r = doc_.editShape(selectedIndex_)->bounds;
         if (r.width() < 5 || r.height() < 5) {
             // 如果太小则删除
-            shapes_.erase(shapes_.begin() + selectedIndex_);
+            doc_.shapes.erase(selectedIndex_);
             selectedIndex_ = -1;
         } else {
             // 确保矩形尺寸正常
@@ -546,49 +1148,53 @@ void FlowView::mouseReleaseEvent(QMouseEvent* event)
             }
             
             // 记录图形创建历史
-            QJsonObject shapeState = shapes_[selectedIndex_]->toJson();
-            recordAction(ActionType::Add, selectedIndex_, QJsonObject(), shapeState);
+            QJsonObject shapeState = doc_.shapes[selectedIndex_]->toJson();
+            doc_.recordAction(ActionType::Add, selectedIndex_, QJsonObject(), shapeState);
             
             // 绘制完成后，切换回选择工具
             mode_ = ToolMode::None;
             setCursor(Qt::ArrowCursor);
         }
         
-        update();
+        invalidateContent();
         return;
     }
 
+    // 拖动结束，图形画回缓存
+    if (dragging_ && event->button() == Qt::LeftButton) {
+        endDrag();
+    }
+
     /* --- 拖拽时，如果移出了画布区域则删除 --- */
     if (selectedIndex_ != -1 && event->button() == Qt::LeftButton)
     {
-        if (docPos.x() < 0 || docPos.y() < 0 || 
-            docPos.x() > pageSize_.width() || docPos.y() > pageSize_.height())
+        if (!isOnPage(docPos))
         {
             // 记录删除前的状态
-            QJsonObject stateBefore = shapes_[selectedIndex_]->toJson();
+            QJsonObject stateBefore = doc_.shapes[selectedIndex_]->toJson();
             int index = selectedIndex_;
             
             // 执行删除
-            shapes_.erase(shapes_.begin() + selectedIndex_);
+            doc_.shapes.erase(selectedIndex_);
             selectedIndex_ = -1;
             
             // 记录删除操作
-            recordAction(ActionType::Delete, index, stateBefore, QJsonObject());
+            doc_.recordAction(ActionType::Delete, index, stateBefore, QJsonObject());
             
-            update();
+            invalidateContent();
         }
     }
  
     if (event->button() == Qt::LeftButton) {
         // 在拖动或调整大小结束时记录历史
         if (selectedIndex_ != -1 && !lastShapeState_.isEmpty()) {
-            QJsonObject currentState = shapes_[selectedIndex_]->toJson();
+            QJsonObject currentState = doc_.shapes[selectedIndex_]->toJson();
             if (resizeHandle_ != ResizeHandle::None) {
                 // 调整大小操作
-                recordAction(ActionType::Resize, selectedIndex_, lastShapeState_, currentState);
+                doc_.recordAction(ActionType::Resize, selectedIndex_, lastShapeState_, currentState);
             } else {
                 // 移动操作
-                recordAction(ActionType::Move, selectedIndex_, lastShapeState_, currentState);
+                doc_.recordAction(ActionType::Move, selectedIndex_, lastShapeState_, currentState);
             }
             lastShapeState_ = QJsonObject(); // 清空保存的状态
         }
@@ -604,6 +1210,8 @@ void FlowView::dragEnterEvent(QDragEnterEvent* e)
 
 void FlowView::dropEvent(QDropEvent* e)
 {
+    if (loading_) return;   // 加载期间只能浏览
+
     QByteArray ba = e->mimeData()->data("application/x-flow-shape");
     QString type = QString::fromUtf8(ba);
 
@@ -611,8 +1219,7 @@ void FlowView::dropEvent(QDropEvent* e)
     QPointF docPos = viewToDoc(e->pos());
     
     // 检查放置位置是否在页面内
-    if (docPos.x() < 0 || docPos.y() < 0 || 
-        docPos.x() > pageSize_.width() || docPos.y() > pageSize_.height()) {
+    if (!isOnPage(docPos)) {
         return;
     }
 
@@ -624,38 +1231,30 @@ void FlowView::dropEvent(QDropEvent* e)
         return;
     }
 
-    std::unique_ptr<Shape> s;
-    if (type == "rect")    s = std::make_unique<Rect>();
-    else if (type == "ellipse") s = std::make_unique<Ellipse>();
-    else if (type == "diamond") s = std::make_unique<Diamond>();
-    else if (type == "triangle") s = std::make_unique<Triangle>();
-    else if (type == "pentagon") s = std::make_unique<Pentagon>();
-    else if (type == "hexagon") s = std::make_unique<Hexagon>();
-    else if (type == "octagon") s = std::make_unique<Octagon>();
-    else if (type == "roundedrect") s = std::make_unique<RoundedRect>();
-    else if (type == "capsule") s = std::make_unique<Capsule>();
-    else if (type == "recttriangle") s = std::make_unique<RectTriangle>();
+    std::unique_ptr<Shape> s = createShape(type);
     if (!s) return;
     
     s->bounds = { docPos.x() - 50, docPos.y() - 30, 100, 60 };
-    shapes_.push_back(std::move(s));
+    doc_.shapes.push_back(std::move(s));
     
     // 选中新放置的图形
-    selectedIndex_ = static_cast<int>(shapes_.size() - 1);
+    selectedIndex_ = static_cast<int>(doc_.shapes.size() - 1);
     
     // 记录图形创建历史
-    QJsonObject shapeState = shapes_[selectedIndex_]->toJson();
-    recordAction(ActionType::Add, selectedIndex_, QJsonObject(), shapeState);
+    QJsonObject shapeState = doc_.shapes[selectedIndex_]->toJson();
+    doc_.recordAction(ActionType::Add, selectedIndex_, QJsonObject(), shapeState);
     
     updatePropertyPanel();
     
-    update();
+    invalidateContent();
     e->acceptProposedAction();
 }
 
 /* ======= 右键菜单 ======= */
 void FlowView::contextMenuEvent(QContextMenuEvent* e)
 {
+    if (loading_) return;
+
     // 将位置从视图坐标转换为文档坐标
     QPointF docPos = viewToDoc(e->pos());
     
@@ -665,13 +1264,7 @@ void FlowView::contextMenuEvent(QContextMenuEvent* e)
     // 如果没有点击到连接线，再检查是否点击了图形
     if (selectedConnectorIndex_ == -1) {
         // 查找点击的图形
-        selectedIndex_ = -1;
-        for (int i = static_cast<int>(shapes_.size()) - 1; i >= 0; --i) {
-            if (shapes_[i]->hitTest(docPos)) {
-                selectedIndex_ = i;
-                break;
-            }
-        }
+        selectedIndex_ = hitTestShape(docPos);
     } else {
         // 如果点击了连接线，清除图形选择
         selectedIndex_ = -1;
@@ -683,22 +1276,19 @@ void FlowView::contextMenuEvent(QContextMenuEvent* e)
     QMenu menu(this);
 
     // 如果在页面内右键，则显示菜单
-    if (docPos.x() >= 0 && docPos.y() >= 0 && 
-        docPos.x() <= pageSize_.width() && docPos.y() <= pageSize_.height()) {
+    if (isOnPage(docPos)) {
         
         // 如果选中了连接线
         if (selectedConnectorIndex_ != -1) {
-            // 创建连接线菜单
-            Connector& conn = connectors_[selectedConnectorIndex_];
+            // 创建连接线菜单（菜单弹出期间连接线列表可能被快照共享，不持有元素的引用）
+            const Connector conn = doc_.connectors.at(selectedConnectorIndex_);
             
             // 添加连接线颜色选项
             QAction* actConnectorColor = menu.addAction(tr("Connector Color"));
-            connect(actConnectorColor, &QAction::triggered, this, [this, &conn]() {
+            connect(actConnectorColor, &QAction::triggered, this, [this, conn]() {
                 QColor color = QColorDialog::getColor(conn.color, this, tr("Select Connector Color"));
                 if (color.isValid()) {
-                    conn.color = color;
-                    emit connectorColorChanged(color);
-                    update();
+                    setConnectorColor(color);   // 记入历史
                 }
             });
             
@@ -706,32 +1296,26 @@ void FlowView::contextMenuEvent(QContextMenuEvent* e)
             QAction* actBidirectional = menu.addAction(tr("Bidirectional"));
             actBidirectional->setCheckable(true);
             actBidirectional->setChecked(conn.bidirectional);
-            connect(actBidirectional, &QAction::toggled, this, [this, &conn](bool checked) {
-                conn.bidirectional = checked;
-                update();
-            });
+            connect(actBidirectional, &QAction::toggled, this, &FlowView::setConnectorBidirectional);
             
             menu.addSeparator();
             
             // 添加删除连接线选项
             QAction* actDeleteConn = menu.addAction(tr("Delete Connection"));
             connect(actDeleteConn, &QAction::triggered, this, [this]() {
-                if (selectedConnectorIndex_ >= 0 && selectedConnectorIndex_ < static_cast<int>(connectors_.size())) {
+                if (selectedConnectorIndex_ >= 0 && selectedConnectorIndex_ < static_cast<int>(doc_.connectors.size())) {
                     // 找出连接线的源和目标图形索引
-                    int srcIndex = -1, dstIndex = -1;
-                    for (size_t i = 0; i < shapes_.size(); ++i) {
-                        if (shapes_[i].get() == connectors_[selectedConnectorIndex_].src) srcIndex = static_cast<int>(i);
-                        if (shapes_[i].get() == connectors_[selectedConnectorIndex_].dst) dstIndex = static_cast<int>(i);
-                    }
+                    int srcIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].src);
+                    int dstIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].dst);
                     
                     // 记录删除连接线历史
                     int index = selectedConnectorIndex_;
-                    recordConnectorAction(ActionType::DeleteConn, index, srcIndex, dstIndex);
+                    doc_.recordConnectorAction(ActionType::DeleteConn, index, srcIndex, dstIndex);
                     
                     // 执行删除
-                    connectors_.erase(connectors_.begin() + selectedConnectorIndex_);
+                    doc_.connectors.erase(doc_.connectors.begin() + selectedConnectorIndex_);
                     selectedConnectorIndex_ = -1;
-                    update();
+                    invalidateContent();
                 }
             });
         }
@@ -775,7 +1359,7 @@ void FlowView::contextMenuEvent(QContextMenuEvent* e)
 void FlowView::copySelection()
 {
     if (selectedIndex_ == -1) return;
-    QJsonDocument doc(shapes_[selectedIndex_]->toJson());
+    QJsonDocument doc(doc_.shapes[selectedIndex_]->toJson());
     QApplication::clipboard()->setText(doc.toJson());
 }
 
@@ -787,64 +1371,56 @@ void FlowView::cutSelection()
 
 void FlowView::pasteClipboard()
 {
+    if (loading_) return;
     QJsonDocument doc = QJsonDocument::fromJson(
         QApplication::clipboard()->text().toUtf8());
     if (!doc.isObject()) return;
     auto obj = doc.object();
 
-    std::unique_ptr<Shape> s;
     QString type = obj["type"].toString();
-    if (type == "rect")    s = std::make_unique<Rect>();
-    else if (type == "ellipse") s = std::make_unique<Ellipse>();
-    else if (type == "diamond") s = std::make_unique<Diamond>();
-    else if (type == "triangle") s = std::make_unique<Triangle>();
-    else if (type == "pentagon") s = std::make_unique<Pentagon>();
-    else if (type == "hexagon") s = std::make_unique<Hexagon>();
-    else if (type == "octagon") s = std::make_unique<Octagon>();
-    else if (type == "roundedrect") s = std::make_unique<RoundedRect>();
-    else if (type == "capsule") s = std::make_unique<Capsule>();
-    else if (type == "recttriangle") s = std::make_unique<RectTriangle>();
+    std::unique_ptr<Shape> s = createShape(type);
     if (!s) return;
     s->fromJson(obj);
     s->bounds.translate(10, 10);       // ΢ƫ
-    shapes_.push_back(std::move(s));
-    update();
+    doc_.shapes.push_back(std::move(s));
+
+    // 记录粘贴历史
+    const int index = static_cast<int>(doc_.shapes.size()) - 1;
+    doc_.recordAction(ActionType::Add, index, QJsonObject(), doc_.shapes[index]->toJson());
+    invalidateContent();
 }
 
 void FlowView::deleteSelection()
 {
     if (selectedIndex_ != -1) {
         // 记录删除前的图形状态
-        QJsonObject stateBefore = shapes_[selectedIndex_]->toJson();
+        QJsonObject stateBefore = doc_.shapes[selectedIndex_]->toJson();
         int index = selectedIndex_;
         
         // 执行删除
-        shapes_.erase(shapes_.begin() + selectedIndex_);
+        doc_.shapes.erase(selectedIndex_);
         selectedIndex_ = -1;
         
         // 记录删除操作
-        recordAction(ActionType::Delete, index, stateBefore, QJsonObject());
+        doc_.recordAction(ActionType::Delete, index, stateBefore, QJsonObject());
         
         updatePropertyPanel();
-        update();
+        invalidateContent();
     } else if (selectedConnectorIndex_ != -1) {
         // 记录删除连接线前，首先找出连接线的源和目标图形索引
-        int srcIndex = -1, dstIndex = -1;
-        for (size_t i = 0; i < shapes_.size(); ++i) {
-            if (shapes_[i].get() == connectors_[selectedConnectorIndex_].src) srcIndex = static_cast<int>(i);
-            if (shapes_[i].get() == connectors_[selectedConnectorIndex_].dst) dstIndex = static_cast<int>(i);
-        }
+        int srcIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].src);
+        int dstIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].dst);
         
         // 记录删除连接线操作
         int index = selectedConnectorIndex_;
-        recordConnectorAction(ActionType::DeleteConn, index, srcIndex, dstIndex);
+        doc_.recordConnectorAction(ActionType::DeleteConn, index, srcIndex, dstIndex);
         
         // 执行删除
-        connectors_.erase(connectors_.begin() + selectedConnectorIndex_);
+        doc_.connectors.erase(doc_.connectors.begin() + selectedConnectorIndex_);
         selectedConnectorIndex_ = -1;
         
         updatePropertyPanel();
-        update();
+        invalidateContent();
     }
 }
 
@@ -857,19 +1433,17 @@ void FlowView::bringToFront()
     QJsonObject before;
     before["index"] = selectedIndex_;
     
-    auto tmp = std::move(shapes_[selectedIndex_]);
-    shapes_.erase(shapes_.begin() + selectedIndex_);
-    shapes_.push_back(std::move(tmp));
+    doc_.shapes.move(selectedIndex_, static_cast<int>(doc_.shapes.size()) - 1);
     
     // 记录操作后的状态（新的位置索引）
     QJsonObject after;
-    after["index"] = static_cast<int>(shapes_.size() - 1);
+    after["index"] = static_cast<int>(doc_.shapes.size() - 1);
     
     // 记录层级操作
-    recordAction(ActionType::ZOrder, selectedIndex_, before, after);
+    doc_.recordAction(ActionType::ZOrder, selectedIndex_, before, after);
     
-    selectedIndex_ = static_cast<int>(shapes_.size() - 1);
-    update();
+    selectedIndex_ = static_cast<int>(doc_.shapes.size() - 1);
+    invalidateContent();
 }
 
 void FlowView::sendToBack()
@@ -880,42 +1454,38 @@ void FlowView::sendToBack()
     QJsonObject before;
     before["index"] = selectedIndex_;
     
-    auto tmp = std::move(shapes_[selectedIndex_]);
-    shapes_.erase(shapes_.begin() + selectedIndex_);
-    shapes_.insert(shapes_.begin(), std::move(tmp));
+    doc_.shapes.move(selectedIndex_, 0);
     
     // 记录操作后的状态（新的位置索引）
     QJsonObject after;
     after["index"] = 0;
     
     // 记录层级操作
-    recordAction(ActionType::ZOrder, selectedIndex_, before, after);
+    doc_.recordAction(ActionType::ZOrder, selectedIndex_, before, after);
     
     selectedIndex_ = 0;
-    update();
+    invalidateContent();
 }
 
 void FlowView::moveUp()
 {
-    if (selectedIndex_ == -1 || selectedIndex_ == static_cast<int>(shapes_.size() - 1)) return;
+    if (selectedIndex_ == -1 || selectedIndex_ == static_cast<int>(doc_.shapes.size() - 1)) return;
     
     // 记录操作前的状态（原来的位置索引）
     QJsonObject before;
     before["index"] = selectedIndex_;
     
-    auto tmp = std::move(shapes_[selectedIndex_]);
-    shapes_.erase(shapes_.begin() + selectedIndex_);
-    shapes_.insert(shapes_.begin() + selectedIndex_ + 1, std::move(tmp));
+    doc_.shapes.move(selectedIndex_, selectedIndex_ + 1);
     
     // 记录操作后的状态（新的位置索引）
     QJsonObject after;
     after["index"] = selectedIndex_ + 1;
     
     // 记录层级操作
-    recordAction(ActionType::ZOrder, selectedIndex_, before, after);
+    doc_.recordAction(ActionType::ZOrder, selectedIndex_, before, after);
     
     selectedIndex_++;
-    update();
+    invalidateContent();
 }
 
 void FlowView::moveDown()
@@ -926,19 +1496,17 @@ void FlowView::moveDown()
     QJsonObject before;
     before["index"] = selectedIndex_;
     
-    auto tmp = std::move(shapes_[selectedIndex_]);
-    shapes_.erase(shapes_.begin() + selectedIndex_);
-    shapes_.insert(shapes_.begin() + selectedIndex_ - 1, std::move(tmp));
+    doc_.shapes.move(selectedIndex_, selectedIndex_ - 1);
     
     // 记录操作后的状态（新的位置索引）
     QJsonObject after;
     after["index"] = selectedIndex_ - 1;
     
     // 记录层级操作
-    recordAction(ActionType::ZOrder, selectedIndex_, before, after);
+    doc_.recordAction(ActionType::ZOrder, selectedIndex_, before, after);
     
     selectedIndex_--;
-    update();
+    invalidateContent();
 }
 
 
@@ -946,46 +1514,46 @@ void FlowView::moveDown()
 void FlowView::setFill(const QColor& c)
 {
     if (selectedIndex_ != -1) {
-        QJsonObject before = shapes_[selectedIndex_]->toJson();
-        shapes_[selectedIndex_]->fillColor = c;
-        QJsonObject after = shapes_[selectedIndex_]->toJson();
-        recordAction(ActionType::Property, selectedIndex_, before, after);
+        QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+        doc_.editShape(selectedIndex_)->setFillColor(c);
+        QJsonObject after = doc_.shapes[selectedIndex_]->toJson();
+        doc_.recordAction(ActionType::Property, selectedIndex_, before, after);
         // 更新属性面板显示
         updatePropertyPanel();
-        update();
+        invalidateContent();
     }
 }
 void FlowView::setStroke(const QColor& c)
 {
     if (selectedIndex_ != -1) {
-        QJsonObject before = shapes_[selectedIndex_]->toJson();
-        shapes_[selectedIndex_]->strokeColor = c;
-        QJsonObject after = shapes_[selectedIndex_]->toJson();
-        recordAction(ActionType::Property, selectedIndex_, before, after);
+        QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+        doc_.editShape(selectedIndex_)->setStrokeColor(c);
+        QJsonObject after = doc_.shapes[selectedIndex_]->toJson();
+        doc_.recordAction(ActionType::Property, selectedIndex_, before, after);
         // 更新属性面板显示
         updatePropertyPanel();
-        update();
+        invalidateContent();
     }
 }
 void FlowView::setWidth(qreal w)
 {
     if (selectedIndex_ != -1) {
-        QJsonObject before = shapes_[selectedIndex_]->toJson();
-        shapes_[selectedIndex_]->strokeWidth = w;
-        QJsonObject after = shapes_[selectedIndex_]->toJson();
-        recordAction(ActionType::Property, selectedIndex_, before, after);
+        QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+        doc_.editShape(selectedIndex_)->setStrokeWidth(w);
+        QJsonObject after = doc_.shapes[selectedIndex_]->toJson();
+        doc_.recordAction(ActionType::Property, selectedIndex_, before, after);
         // 更新属性面板显示
         updatePropertyPanel();
-        update();
+        invalidateContent();
     }
 }
 
 
-void FlowView::updateConnectorsFor(Shape* movedShape)
+void FlowView::updateConnectorsFor(const Shape* movedShape)
 {
     if (!movedShape) return;
     
-    for (auto& conn : connectors_) {
+    for (const auto& conn : qAsConst(doc_.connectors)) {
         if (conn.src == movedShape || conn.dst == movedShape) {
             // 连接线的起点或终点被移动，随之更新连接线
             // 注意：这里不需要做任何事情，因为Connector类在绘制时
@@ -996,41 +1564,46 @@ void FlowView::updateConnectorsFor(Shape* movedShape)
 
 void FlowView::mouseDoubleClickEvent(QMouseEvent* e)
 {
+    if (loading_) return;
+
     // 将视图坐标转换为文档坐标
     QPointF docPos = viewToDoc(e->pos());
     
     // 如果双击了已选中的图形，弹出文本编辑对话框
-    if (selectedIndex_ != -1 && shapes_[selectedIndex_]->hitTest(docPos)) {
+    if (selectedIndex_ != -1 && doc_.shapes[selectedIndex_]->hitTest(docPos)) {
         TextEditDialog dlg(this);
-        dlg.setText(shapes_[selectedIndex_]->text);
-        dlg.setTextColor(shapes_[selectedIndex_]->textColor);
-        dlg.setTextSize(shapes_[selectedIndex_]->textSize);
+        dlg.setText(doc_.shapes[selectedIndex_]->text);
+        dlg.setTextColor(doc_.shapes[selectedIndex_]->textColor());
+        dlg.setTextSize(doc_.shapes[selectedIndex_]->textSize());
         
         if (dlg.exec() == QDialog::Accepted) {
             // 保存修改前的状态
-            QJsonObject stateBefore = shapes_[selectedIndex_]->toJson();
+            QJsonObject stateBefore = doc_.shapes[selectedIndex_]->toJson();
             
             // 应用新文本
-            shapes_[selectedIndex_]->text = dlg.getText();
-            shapes_[selectedIndex_]->textColor = dlg.getTextColor();
-            shapes_[selectedIndex_]->textSize = dlg.getTextSize();
+            Shape* shape = doc_.editShape(selectedIndex_);
+            shape->text = dlg.getText();
+            Style style = *shape->style;
+            style.textColor = dlg.getTextColor();
+            style.textSize = dlg.getTextSize();
+            shape->style = Style::intern(style);
             
             // 记录修改历史
-            QJsonObject stateAfter = shapes_[selectedIndex_]->toJson();
-            recordAction(ActionType::Property, selectedIndex_, stateBefore, stateAfter);
+            QJsonObject stateAfter = doc_.shapes[selectedIndex_]->toJson();
+            doc_.recordAction(ActionType::Property, selectedIndex_, stateBefore, stateAfter);
             
-            update();
+            invalidateContent();
         }
         return;
     }
     
     // 如果双击了连接线，弹出连接线样式对话框
     int connIndex = hitTestConnector(docPos);
-    if (connIndex >= 0 && connIndex < static_cast<int>(connectors_.size())) {
+    if (connIndex >= 0 && connIndex < static_cast<int>(doc_.connectors.size())) {
         selectedConnectorIndex_ = connIndex;
         
         // 弹出颜色选择器
-        QColor color = QColorDialog::getColor(connectors_[connIndex].color, this, tr("Select Connector Color"));
+        QColor color = QColorDialog::getColor(doc_.connectors[connIndex].color, this, tr("Select Connector Color"));
         if (color.isValid()) {
             setConnectorColor(color);
         }
@@ -1047,276 +1620,402 @@ void FlowView::mouseDoubleClickEvent(QMouseEvent* e)
 void FlowView::setTextColor(const QColor& c)
 {
     if (selectedIndex_ == -1 || !c.isValid()) return;
-    shapes_[selectedIndex_]->textColor = c;
+    QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+    doc_.editShape(selectedIndex_)->setTextColor(c);
+    doc_.recordAction(ActionType::Property, selectedIndex_, before, doc_.shapes[selectedIndex_]->toJson());
     // 更新属性面板显示
     updatePropertyPanel();
-    update();
+    invalidateContent();
 }
 
 // 添加文本大小设置
 void FlowView::setTextSize(int size)
 {
     if (selectedIndex_ == -1 || size <= 0) return;
-    shapes_[selectedIndex_]->textSize = size;
+    QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+    doc_.editShape(selectedIndex_)->setTextSize(size);
+    doc_.recordAction(ActionType::Property, selectedIndex_, before, doc_.shapes[selectedIndex_]->toJson());
     // 更新属性面板显示
     updatePropertyPanel();
-    update();
+    invalidateContent();
 }
 
 // 添加文本内容设置
 void FlowView::setText(const QString& text)
 {
-    if (selectedIndex_ == -1) return;
-    shapes_[selectedIndex_]->text = text;
-    update();
+    if (selectedIndex_ == -1 || doc_.shapes[selectedIndex_]->text == text) return;
+    QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+    doc_.editShape(selectedIndex_)->text = text;
+    doc_.recordAction(ActionType::Property, selectedIndex_, before, doc_.shapes[selectedIndex_]->toJson());
+    invalidateContent();
 }
 
 /* ---------- 文件操作 ---------- */
 
 bool FlowView::saveToFile(const QString& filename)
 {
-    QJsonObject root;
-    
-    // 保存页面属性
-    QJsonObject pageObj;
-    pageObj["backgroundColor"] = backgroundColor_.name(QColor::HexArgb);
-    pageObj["width"] = pageSize_.width();
-    pageObj["height"] = pageSize_.height();
-    pageObj["showGrid"] = showGrid_;
-    root["page"] = pageObj;
-    
-    // 保存所有图形
-    QJsonArray shapesArray;
-    for (const auto& shape : shapes_) {
-        shapesArray.append(shape->toJson());
-    }
-    root["shapes"] = shapesArray;
-    
-    // 保存所有连接线
-    QJsonArray connArray;
-    for (const auto& conn : connectors_) {
-        // 需要找到连接线的源和目标在shapes中的索引
-        int srcIdx = -1, dstIdx = -1;
-        for (size_t i = 0; i < shapes_.size(); ++i) {
-            if (shapes_[i].get() == conn.src) srcIdx = i;
-            if (shapes_[i].get() == conn.dst) dstIdx = i;
-        }
-        
-        if (srcIdx >= 0 && dstIdx >= 0) {
-            QJsonObject connObj;
-            connObj["src"] = srcIdx;
-            connObj["dst"] = dstIdx;
-            connObj["color"] = conn.color.name(QColor::HexArgb);
-            connObj["width"] = conn.width;
-            connObj["bidirectional"] = conn.bidirectional;
-            connArray.append(connObj);
-        }
-    }
-    root["connectors"] = connArray;
-    
-    // 写入文件
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) {
+    if (loading_) return false;   // 未加载完的文档不能保存
+
+    compactor_->cancel();
+    compactTimer_.stop();
+    if (!doc_.saveToFile(filename)) {
         return false;
     }
-    
-    QJsonDocument doc(root);
-    file.write(doc.toJson());
+
+    // 另存为其他文件时，原文件的已保存编辑合并回原文件
+    if (journal_.isOpen() && journal_.documentFile() != filename) journal_.compactSaved();
+
+    // 文件已完整写出，从空日志重新开始；日志无法写入时（如只读目录）改由自动保存跟踪
+    journal_.close();
+    if (journal_.start(filename)) {
+        autosaver_->stop();
+    } else {
+        autosaver_->track(filename);
+    }
+    currentFile_ = filename;
     return true;
 }
 
-bool FlowView::loadFromFile(const QString& filename)
+bool FlowView::save()
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return false;
+    if (loading_ || currentFile_.isEmpty()) return false;
+    if (!journal_.isOpen()) return saveToFile(currentFile_);   // 没有日志时完整写出
+    if (!journal_.commit()) return false;
+
+    // 已保存的记录积累到一定量后在后台合并回文件；不足时等空闲一段时间后再合并
+    if (journal_.needsCompaction()) {
+        compactTimer_.stop();
+        compactor_->start(currentFile_, journal_.savedRecords());
+    } else {
+        compactTimer_.start();
     }
-    
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    if (!doc.isObject()) {
+    return true;
+}
+
+bool FlowView::loadFromFile(const QString& filename)
+{
+    cancelLoad();
+    compactor_->cancel();
+    Journal::recoverCompaction(filename);
+    // 重新打开当前文件：先把已保存的编辑合并回文件，之后关闭日志时不会再替换刚加载的文件
+    if (journal_.documentFile() == filename) journal_.compactSaved();
+
+    // 加载失败时文档保持不变
+    if (!doc_.loadFromFile(filename)) {
         return false;
     }
+    doc_.clearHistory();
+    closeJournal();
+    openJournal(filename);
     
-    // 清空当前数据
-    clearAll();
-    
-    QJsonObject root = doc.object();
-    
-    // 加载页面属性
-    if (root.contains("page") && root["page"].isObject()) {
-        QJsonObject pageObj = root["page"].toObject();
-        backgroundColor_ = QColor(pageObj["backgroundColor"].toString("#fdfdfd"));
-        pageSize_ = QSize(
-            pageObj["width"].toInt(2000),
-            pageObj["height"].toInt(2000)
-        );
-        showGrid_ = pageObj["showGrid"].toBool(true);
+    // 清空选中和临时绘制状态
+    selectedIndex_ = -1;
+    selectedConnectorIndex_ = -1;
+    currentConn_ = Connector{};
+    invalidateContent();
+    emit documentReset();
+    return true;
+}
+
+void FlowView::openFileAsync(const QString& filename)
+{
+    cancelLoad();
+    compactor_->cancel();
+    Journal::recoverCompaction(filename);
+    // 重新打开当前文件：先把已保存的编辑合并回文件，之后关闭日志时不会再替换刚加载的文件
+    if (journal_.documentFile() == filename) journal_.compactSaved();
+
+    // 暂存当前文档，加载失败时恢复；加载期间画布从空白开始逐步显示
+    stash_ = std::make_unique<StashedDocument>();
+    stash_->shapes = std::move(doc_.shapes);
+    stash_->connectors = std::move(doc_.connectors);
+    stash_->backgroundColor = doc_.backgroundColor;
+    stash_->pageSize = doc_.pageSize;
+    stash_->showGrid = doc_.showGrid;
+    doc_.clear();
+
+    selectedIndex_ = -1;
+    selectedConnectorIndex_ = -1;
+    resizeHandle_ = ResizeHandle::None;
+    currentConn_ = Connector{};
+    loadOrder_.clear();
+    loading_ = true;
+    loadingFile_ = filename;
+    loadingRecovery_ = false;
+    autosaver_->setSuspended(true);
+
+    // 当前可见区域优先加载（仅对带有图形坐标的 .fdb 文件有效）
+    loader_->start(filename, visibleDocRect());
+    updatePropertyPanel();
+    invalidateContent();
+    emit documentReset();
+}
+
+void FlowView::applyLoadedData()
+{
+    if (!loading_) return;
+    DocumentLoader::Pending pending = loader_->take();
+
+    if (pending.hasPage) {
+        doc_.backgroundColor = pending.backgroundColor;
+        doc_.pageSize = pending.pageSize;
+        doc_.showGrid = pending.showGrid;
+    }
+
+    // 按文件中的索引插入，保证最终顺序（z-order）与文件一致；顺序到达时直接追加
+    QRectF area;
+    for (LoadedShape& loaded : pending.shapes) {
+        if (!loaded.shape) continue;
+        area |= loaded.shape->bounds.normalized();
+        if (loadOrder_.empty() || loaded.index > loadOrder_.back()) {
+            loadOrder_.push_back(loaded.index);
+            doc_.shapes.push_back(std::move(loaded.shape));
+        } else {
+            auto it = std::upper_bound(loadOrder_.begin(), loadOrder_.end(), loaded.index);
+            size_t pos = static_cast<size_t>(it - loadOrder_.begin());
+            loadOrder_.insert(it, loaded.index);
+            doc_.shapes.insert(static_cast<int>(pos), std::move(loaded.shape));
+        }
     }
-    
-    // 加载图形
-    if (root.contains("shapes") && root["shapes"].isArray()) {
-        QJsonArray shapesArray = root["shapes"].toArray();
-        for (const QJsonValue& val : shapesArray) {
-            if (!val.isObject()) continue;
-            
-            QJsonObject shapeObj = val.toObject();
-            QString type = shapeObj["type"].toString();
-            
-            std::unique_ptr<Shape> shape;
-            if (type == "rect") {
-                shape = std::make_unique<Rect>();
-            } else if (type == "ellipse") {
-                shape = std::make_unique<Ellipse>();
-            } else if (type == "diamond") {
-                shape = std::make_unique<Diamond>();
-            } else if (type == "triangle") {
-                shape = std::make_unique<Triangle>();
-            } else if (type == "pentagon") {
-                shape = std::make_unique<Pentagon>();
-            } else if (type == "hexagon") {
-                shape = std::make_unique<Hexagon>();
-            } else if (type == "octagon") {
-                shape = std::make_unique<Octagon>();
-            } else if (type == "roundedrect") {
-                shape = std::make_unique<RoundedRect>();
-            } else if (type == "capsule") {
-                shape = std::make_unique<Capsule>();
-            } else if (type == "recttriangle") {
-                shape = std::make_unique<RectTriangle>();
-            }
-            
-            if (shape) {
-                shape->fromJson(shapeObj);
-                shapes_.push_back(std::move(shape));
+
+    // 连接线在所有图形之后到达，按文件索引找到两端图形
+    if (pending.hasConnectors) {
+        std::vector<const Shape*> byIndex(loadOrder_.empty() ? 0 : loadOrder_.back() + 1, nullptr);
+        for (size_t i = 0; i < loadOrder_.size(); ++i) {
+            byIndex[loadOrder_[i]] = doc_.shapes[i];
+        }
+        for (const ConnectorSpec& spec : pending.connectors) {
+            if (spec.src < 0 || spec.src >= static_cast<int>(byIndex.size()) ||
+                spec.dst < 0 || spec.dst >= static_cast<int>(byIndex.size()) ||
+                !byIndex[spec.src] || !byIndex[spec.dst]) {
+                continue;
             }
+            Connector conn;
+            conn.src = byIndex[spec.src];
+            conn.dst = byIndex[spec.dst];
+            conn.color = spec.color;
+            conn.width = spec.width;
+            conn.bidirectional = spec.bidirectional;
+            doc_.connectors.push_back(conn);
         }
     }
-    
-    // 加载连接线
-    if (root.contains("connectors") && root["connectors"].isArray()) {
-        QJsonArray connArray = root["connectors"].toArray();
-        for (const QJsonValue& val : connArray) {
-            if (!val.isObject()) continue;
-            
-            QJsonObject connObj = val.toObject();
-            int srcIdx = connObj["src"].toInt(-1);
-            int dstIdx = connObj["dst"].toInt(-1);
-            
-            if (srcIdx >= 0 && srcIdx < shapes_.size() &&
-                dstIdx >= 0 && dstIdx < shapes_.size()) {
-                Connector conn;
-                conn.src = shapes_[srcIdx].get();
-                conn.dst = shapes_[dstIdx].get();
-                conn.color = QColor(connObj["color"].toString("#ff000000"));
-                conn.width = connObj["width"].toDouble(1.0);
-                conn.bidirectional = connObj["bidirectional"].toBool(false);
-                connectors_.push_back(conn);
-            }
+
+    invalidateContent();
+    if (pending.hasPage || pending.hasConnectors) {
+        emit documentReset();
+    } else if (!area.isNull()) {
+        emit contentChanged(area);
+    }
+}
+
+void FlowView::finishLoad(bool ok)
+{
+    if (!loading_) return;
+    endLoad(ok);
+    if (ok) {
+        // 原文档的日志在新文档加载成功后才关闭，加载失败时原文档仍可继续编辑和保存
+        closeJournal();
+        if (loadingRecovery_) {
+            // 恢复的内容只存在于恢复文件中：继续由自动保存写入同一个恢复文件，保存时完整写出
+            currentFile_ = recoverySource_;
+            autosaver_->track(recoverySource_, loadingFile_);
+        } else {
+            openJournal(loadingFile_);
         }
+        invalidateContent();
+        emit documentReset();   // 日志中恢复的编辑没有经过观察者
     }
-    
-    update();
-    return true;
+    loadingRecovery_ = false;
+    emit loadFinished(ok);
 }
 
-bool FlowView::exportToPng(const QString& filename)
+void FlowView::endLoad(bool ok)
 {
-    QImage image(pageSize_, QImage::Format_ARGB32);
-    image.fill(backgroundColor_);
-    
-    QPainter painter(&image);
-    painter.setRenderHint(QPainter::Antialiasing);
-    
-    // 绘制网格
-    if (showGrid_) {
-        const int step = 20;
-        painter.setPen(QColor(220, 220, 220));
-        for (int x = 0; x < pageSize_.width(); x += step) 
-            painter.drawLine(x, 0, x, pageSize_.height());
-        for (int y = 0; y < pageSize_.height(); y += step) 
-            painter.drawLine(0, y, pageSize_.width(), y);
+    loading_ = false;
+    loadOrder_.clear();
+    autosaver_->setSuspended(false);
+
+    if (ok) {
+        doc_.clearHistory();   // 新文档，旧的撤销记录已不适用
+    } else if (stash_) {
+        doc_.clear();
+        doc_.shapes = std::move(stash_->shapes);
+        doc_.connectors = std::move(stash_->connectors);
+        doc_.backgroundColor = stash_->backgroundColor;
+        doc_.pageSize = stash_->pageSize;
+        doc_.showGrid = stash_->showGrid;
+        emit documentReset();
+    }
+    stash_.reset();
+    invalidateContent();
+}
+
+void FlowView::cancelLoad()
+{
+    if (!loading_) return;
+    loader_->cancel();
+    endLoad(false);   // 恢复加载前的文档
+    emit loadCancelled();
+}
+
+void FlowView::panBy(const QPointF& delta)
+{
+    // 偏移量保持整像素，已绘制的画面才能原样整体移动
+    const QPointF target(qRound(viewOffset_.x() + delta.x()), qRound(viewOffset_.y() + delta.y()));
+    const bool aligned = viewOffset_ == QPointF(viewOffset_.toPoint());
+    const QPoint shift = target.toPoint() - viewOffset_.toPoint();
+    viewOffset_ = target;
+
+    // 统计面板固定在窗口角上，不能随画面移动；移动距离超过窗口时没有可复用的部分
+    if (!aligned || showStats_ || qAbs(shift.x()) >= width() || qAbs(shift.y()) >= height()) {
+        update();
+    } else if (!shift.isNull()) {
+        scroll(shift.x(), shift.y());   // 复制已绘制的像素，只重绘新露出的条带
     }
-    
-    // 绘制连接线
-    for (const auto& c : connectors_) 
-        c.paint(painter);
-    
-    // 绘制图形
-    for (const auto& shape : shapes_) 
-        shape->paint(painter, false);
-    
-    return image.save(filename, "PNG");
+    emit viewChanged();
 }
 
-bool FlowView::exportToSvg(const QString& filename)
+void FlowView::centerOn(const QPointF& docPos)
 {
-    QSvgGenerator generator;
-    generator.setFileName(filename);
-    generator.setSize(pageSize_);
-    generator.setViewBox(QRect(0, 0, pageSize_.width(), pageSize_.height()));
-    generator.setTitle("FlowDraw Diagram");
-    generator.setDescription("Created with FlowDraw");
-    
-    QPainter painter;
-    painter.begin(&generator);
-    painter.setRenderHint(QPainter::Antialiasing);
-    
-    // 背景
-    painter.fillRect(QRect(0, 0, pageSize_.width(), pageSize_.height()), backgroundColor_);
-    
-    // 绘制网格
-    if (showGrid_) {
-        const int step = 20;
-        painter.setPen(QColor(220, 220, 220));
-        for (int x = 0; x < pageSize_.width(); x += step) 
-            painter.drawLine(x, 0, x, pageSize_.height());
-        for (int y = 0; y < pageSize_.height(); y += step) 
-            painter.drawLine(0, y, pageSize_.width(), y);
+    panBy(QPointF(width() / 2.0, height() / 2.0) - docToView(docPos));
+}
+
+void FlowView::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    emit viewChanged();
+}
+
+QRectF FlowView::visibleDocRect() const
+{
+    return QRectF(viewToDoc(QPointF(0, 0)), viewToDoc(QPointF(width(), height())));
+}
+
+/* ---------- 编辑日志 ---------- */
+
+void FlowView::openJournal(const QString& filename)
+{
+    // 上次没有正常退出时，保存标记之后还有未保存的编辑，询问是否恢复
+    const Journal::Status status = Journal::inspect(filename);
+    bool recover = false;
+    if (status.valid && status.unsavedRecords > 0) {
+        recover = QMessageBox::question(this, tr("Recover Changes"),
+            tr("%1 has %2 unsaved change(s) from a session that did not exit normally.\n"
+               "Recover them?").arg(QFileInfo(filename).fileName()).arg(status.unsavedRecords),
+            QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) == QMessageBox::Yes;
+    }
+
+    // 基础文件 + 已保存的记录才是保存时的文档
+    if (status.valid) {
+        Journal::replay(filename, doc_, recover ? Journal::Replay::All : Journal::Replay::SavedOnly);
+        doc_.clearHistory();
+        selectedIndex_ = -1;
+        selectedConnectorIndex_ = -1;
     }
-    
-    // 绘制连接线
-    for (const auto& c : connectors_) 
-        c.paint(painter);
-    
-    // 绘制图形
-    for (const auto& shape : shapes_) 
-        shape->paint(painter, false);
-    
-    painter.end();
-    return true;
+
+    journal_.resume(filename, recover);
+    currentFile_ = filename;
+
+    // 编辑日志已经逐条记录，不需要再自动保存
+    if (journal_.isOpen()) {
+        autosaver_->stop();
+    } else {
+        autosaver_->track(filename);
+        if (recover) autosaver_->markModified();   // 恢复的编辑只在内存中
+    }
+}
+
+void FlowView::openRecoveryAsync(const QString& recoveryFile, const QString& source)
+{
+    openFileAsync(recoveryFile);
+    loadingRecovery_ = true;
+    recoverySource_ = source;
+}
+
+void FlowView::closeJournal()
+{
+    compactor_->cancel();
+    compactTimer_.stop();
+    // 已保存的编辑合并回文件：文件被复制、提交或由命令行工具单独打开时，内容都是最新的
+    journal_.compactSaved();
+    journal_.close();
+    currentFile_.clear();
+}
+
+void FlowView::finishCompaction(const QString& docFile, const QString& compactFile, int records, bool ok)
+{
+    if (!ok) return;   // 合并失败不影响日志，下次保存时重试
+    if (docFile != journal_.documentFile()) {
+        QFile::remove(compactFile);
+        return;
+    }
+    journal_.finishCompaction(compactFile, records);
+}
+
+bool FlowView::exportToPng(const QString& filename)
+{
+    if (loading_) return false;
+    // 按窗口所在屏幕的像素比导出，高分屏上查看导出的图片同样清晰
+    RenderOptions options;
+    options.pixelRatio = devicePixelRatioF();
+    return doc_.exportToPng(filename, options);
+}
+
+bool FlowView::exportToSvg(const QString& filename)
+{
+    if (loading_) return false;
+    return doc_.exportToSvg(filename);
 }
 
 void FlowView::clearAll()
 {
-    shapes_.clear();
-    connectors_.clear();
+    cancelLoad();
+    closeJournal();
+    doc_.clear();
+    doc_.clearHistory();
+    autosaver_->track(QString());
     selectedIndex_ = -1;
+    selectedConnectorIndex_ = -1;
     currentConn_ = Connector{};
-    update();
+    invalidateContent();
+    emit documentReset();
 }
 
 /* ---------- 页面设置 ---------- */
 
 void FlowView::setBackgroundColor(const QColor& color)
 {
-    if (color.isValid()) {
-        backgroundColor_ = color;
-        update();
+    if (color.isValid() && !loading_) {
+        doc_.backgroundColor = color;
+        doc_.notifyPageChanged();
+        invalidateContent();
     }
 }
 
 void FlowView::setPageSize(int width, int height)
 {
-    if (width > 0 && height > 0) {
-        pageSize_ = QSize(width, height);
-        update();
+    // 宽高都为 0 表示切换为无边界画布
+    const bool unbounded = width == 0 && height == 0;
+    if ((unbounded || (width > 0 && height > 0)) && !loading_) {
+        doc_.pageSize = QSize(width, height);
+        doc_.notifyPageChanged();
+        invalidateContent();
     }
 }
 
 void FlowView::setGridVisible(bool visible)
 {
-    showGrid_ = visible;
-    update();
+    if (loading_) return;
+    doc_.showGrid = visible;
+    doc_.notifyPageChanged();
+    invalidateContent();
+}
+
+bool FlowView::isOnPage(const QPointF& docPos) const
+{
+    if (doc_.isUnbounded()) return true;
+    return docPos.x() >= 0 && docPos.y() >= 0 &&
+           docPos.x() <= doc_.pageSize.width() && docPos.y() <= doc_.pageSize.height();
 }
 
 // 视图坐标到文档坐标的转换
@@ -1335,7 +2034,7 @@ QPointF FlowView::docToView(const QPointF& docPoint) const
 void FlowView::drawPageBorder(QPainter& painter)
 {
     QRectF pageRect = QRectF(docToView(QPointF(0, 0)), 
-                             docToView(QPointF(pageSize_.width(), pageSize_.height())));
+                             docToView(QPointF(doc_.pageSize.width(), doc_.pageSize.height())));
     
     // 绘制页面阴影
     painter.setPen(Qt::NoPen);
@@ -1344,29 +2043,25 @@ void FlowView::drawPageBorder(QPainter& painter)
     
     // 绘制页面边框
     painter.setPen(QPen(Qt::gray, 1.0));
-    painter.setBrush(backgroundColor_);
+    painter.setBrush(doc_.backgroundColor);
     painter.drawRect(pageRect);
 }
 
 // 鼠标滚轮事件处理
 void FlowView::wheelEvent(QWheelEvent* event)
 {
+    const qint64 arrival = latency_.now();
     if (event->modifiers() & Qt::ControlModifier) {
         // Ctrl+滚轮用于缩放
-        const qreal zoomFactor = 1.15;
-        if (event->angleDelta().y() > 0) {
-            // 放大
-            scale_ *= zoomFactor;
-        } else {
-            // 缩小
-            scale_ /= zoomFactor;
-        }
-        
-        // 限制缩放范围，防止过大或过小
-        scale_ = qBound(0.1, scale_, 5.0);
-        
-        // 更新视图
-        update();
+        latency_.markInput(LatencyTracker::Zoom, arrival);
+        beginGesture();
+        // 连续缩放：每格（120）缩放 15%，触控板的小增量按比例缩放；以光标位置为中心
+        const qreal factor = std::pow(1.15, event->angleDelta().y() / 120.0);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        zoomAt(factor, event->position());
+#else
+        zoomAt(factor, event->posF());
+#endif
     } else {
         // 普通滚轮用于垂直滚动，Shift+滚轮用于水平滚动
         int dx = 0, dy = 0;
@@ -1376,8 +2071,9 @@ void FlowView::wheelEvent(QWheelEvent* event)
             dy = -event->angleDelta().y();
         }
         
-        viewOffset_ += QPointF(dx, dy) * 0.5;
-        update();
+        latency_.markInput(LatencyTracker::Pan, arrival);
+        beginGesture();
+        panBy(QPointF(dx, dy) * 0.5);
     }
     
     event->accept();
@@ -1463,26 +2159,26 @@ void FlowView::keyPressEvent(QKeyEvent* event)
             break;
             
         case Qt::Key_Left:
-            viewOffset_.rx() += step;
-            update();
+            beginGesture();
+            panBy(QPointF(step, 0));
             event->accept();
             return;
             
         case Qt::Key_Right:
-            viewOffset_.rx() -= step;
-            update();
+            beginGesture();
+            panBy(QPointF(-step, 0));
             event->accept();
             return;
             
         case Qt::Key_Up:
-            viewOffset_.ry() += step;
-            update();
+            beginGesture();
+            panBy(QPointF(0, step));
             event->accept();
             return;
             
         case Qt::Key_Down:
-            viewOffset_.ry() -= step;
-            update();
+            beginGesture();
+            panBy(QPointF(0, -step));
             event->accept();
             return;
             
@@ -1521,16 +2217,20 @@ void FlowView::keyReleaseEvent(QKeyEvent* event)
 // 实现缩放相关方法
 void FlowView::zoomIn()
 {
+    latency_.markInput(LatencyTracker::Zoom, latency_.now());
     scale_ *= 1.2;
     scale_ = qBound(0.1, scale_, 5.0);
     update();
+    emit viewChanged();
 }
 
 void FlowView::zoomOut()
 {
+    latency_.markInput(LatencyTracker::Zoom, latency_.now());
     scale_ /= 1.2;
     scale_ = qBound(0.1, scale_, 5.0);
     update();
+    emit viewChanged();
 }
 
 void FlowView::resetZoom()
@@ -1538,19 +2238,26 @@ void FlowView::resetZoom()
     scale_ = 1.0;
     viewOffset_ = QPointF(0, 0);
     update();
+    emit viewChanged();
 }
 
 void FlowView::fitToWindow()
 {
-    // 计算合适的缩放比例和偏移量，使页面正好适合视图
-    qreal scaleX = width() / (pageSize_.width() + 40.0);
-    qreal scaleY = height() / (pageSize_.height() + 40.0);
+    // 计算合适的缩放比例和偏移量，使页面（无边界画布为全部内容）正好适合视图
+    const QRectF extent = doc_.extent();
+    if (extent.isEmpty()) {
+        resetZoom();
+        return;
+    }
+    qreal scaleX = width() / (extent.width() + 40.0);
+    qreal scaleY = height() / (extent.height() + 40.0);
     scale_ = qMin(scaleX, scaleY);
     
     // 居中显示
-    viewOffset_ = QPointF((width() - pageSize_.width() * scale_) / 2,
-                         (height() - pageSize_.height() * scale_) / 2);
+    viewOffset_ = QPointF((width() - extent.width() * scale_) / 2,
+                         (height() - extent.height() * scale_) / 2) - extent.topLeft() * scale_;
     update();
+    emit viewChanged();
 }
 
 // 绘制调整大小的控制柄
@@ -1694,7 +2401,7 @@ void FlowView::updatePropertyPanel()
 {
     // 如果选中了连接线
     if (selectedConnectorIndex_ != -1) {
-        auto& conn = connectors_[selectedConnectorIndex_];
+        auto& conn = doc_.connectors[selectedConnectorIndex_];
         emit shapeAttr({}, conn.color, conn.width);
         emit shapeSize(0, 0);  // 连接线没有尺寸属性
         emit connectorColorChanged(conn.color);  // 发送连接线颜色
@@ -1703,8 +2410,8 @@ void FlowView::updatePropertyPanel()
 
     // 如果选中了图形
     if (selectedIndex_ != -1) {
-        auto* shape = shapes_[selectedIndex_].get();
-        emit shapeAttr(shape->fillColor, shape->strokeColor, shape->strokeWidth);
+        const Shape* shape = doc_.shapes[selectedIndex_];
+        emit shapeAttr(shape->fillColor(), shape->strokeColor(), shape->strokeWidth());
         
         // 发送尺寸信息
         int width = shape->bounds.width();
@@ -1712,8 +2419,8 @@ void FlowView::updatePropertyPanel()
         emit shapeSize(width, height);
         
         // 发送文本属性信息
-        emit textColorChanged(shape->textColor);
-        emit textSizeChanged(shape->textSize);
+        emit textColorChanged(shape->textColor());
+        emit textSizeChanged(shape->textSize());
         
         // 未选中连接线时，发送空颜色
         emit connectorColorChanged(QColor());
@@ -1733,19 +2440,22 @@ void FlowView::setObjectWidth(int width)
     if (selectedIndex_ == -1 || width <= 0) return;
     
     // 获取当前矩形
-    auto& bounds = shapes_[selectedIndex_]->bounds;
+    const QRectF bounds = doc_.shapes[selectedIndex_]->bounds;
     
     // 计算新宽度，保持左边缘不变
     QRectF newBounds = bounds;
     newBounds.setWidth(width);
+    if (newBounds == bounds) return;
     
-    // 设置新矩形
-    shapes_[selectedIndex_]->bounds = newBounds;
+    // 设置新矩形（记入历史，编辑日志和自动保存都依赖它）
+    QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+    doc_.editShape(selectedIndex_)->bounds = newBounds;
+    doc_.recordAction(ActionType::Resize, selectedIndex_, before, doc_.shapes[selectedIndex_]->toJson());
     
     // 更新连接器
-    updateConnectorsFor(shapes_[selectedIndex_].get());
+    updateConnectorsFor(doc_.shapes[selectedIndex_]);
     
-    update();
+    invalidateContent();
 }
 
 // 设置对象高度
@@ -1754,19 +2464,22 @@ void FlowView::setObjectHeight(int height)
     if (selectedIndex_ == -1 || height <= 0) return;
     
     // 获取当前矩形
-    auto& bounds = shapes_[selectedIndex_]->bounds;
+    const QRectF bounds = doc_.shapes[selectedIndex_]->bounds;
     
     // 计算新高度，保持顶边不变
     QRectF newBounds = bounds;
     newBounds.setHeight(height);
+    if (newBounds == bounds) return;
     
-    // 设置新矩形
-    shapes_[selectedIndex_]->bounds = newBounds;
+    // 设置新矩形（记入历史，编辑日志和自动保存都依赖它）
+    QJsonObject before = doc_.shapes[selectedIndex_]->toJson();
+    doc_.editShape(selectedIndex_)->bounds = newBounds;
+    doc_.recordAction(ActionType::Resize, selectedIndex_, before, doc_.shapes[selectedIndex_]->toJson());
     
     // 更新连接器
-    updateConnectorsFor(shapes_[selectedIndex_].get());
+    updateConnectorsFor(doc_.shapes[selectedIndex_]);
     
-    update();
+    invalidateContent();
 }
 
 void FlowView::setToolMode(ToolMode m)
@@ -1791,11 +2504,14 @@ void FlowView::setToolMode(ToolMode m)
 // 查找点击了哪个连接线
 int FlowView::hitTestConnector(const QPointF& pt) const
 {
+    TraceSpan span("FlowView::hitTestConnector", "input");
+    span.arg("connectors", static_cast<int>(doc_.connectors.size()));
     const double hitDistance = 12.0; // 增大点击误差范围，更容易选中(从8.0改为12.0)
     
-    for (int i = 0; i < static_cast<int>(connectors_.size()); ++i) {
-        const Connector& conn = connectors_[i];
+    for (int i = 0; i < static_cast<int>(doc_.connectors.size()); ++i) {
+        const Connector& conn = doc_.connectors[i];
         if (!conn.src || !conn.dst) continue;
+        stats_.countHitTests();
         
         // 获取连接线的两个端点
         QPointF p1 = conn.src->getConnectionPoint(conn.dst->bounds.center());
@@ -1852,28 +2568,25 @@ int FlowView::hitTestConnector(const QPointF& pt) const
 // 设置连接线为双向箭头
 void FlowView::setConnectorBidirectional(bool bidirectional)
 {
-    if (selectedConnectorIndex_ >= 0 && selectedConnectorIndex_ < connectors_.size()) {
+    if (selectedConnectorIndex_ >= 0 && selectedConnectorIndex_ < doc_.connectors.size()) {
         // 记录修改前的状态
         QJsonObject before;
-        before["bidirectional"] = connectors_[selectedConnectorIndex_].bidirectional;
-        before["color"] = connectors_[selectedConnectorIndex_].color.name();
-        before["width"] = connectors_[selectedConnectorIndex_].width;
+        before["bidirectional"] = doc_.connectors[selectedConnectorIndex_].bidirectional;
+        before["color"] = doc_.connectors[selectedConnectorIndex_].color.name();
+        before["width"] = doc_.connectors[selectedConnectorIndex_].width;
         
         // 执行修改
-        connectors_[selectedConnectorIndex_].bidirectional = bidirectional;
+        doc_.connectors[selectedConnectorIndex_].bidirectional = bidirectional;
         
         // 记录修改后的状态
         QJsonObject after;
-        after["bidirectional"] = connectors_[selectedConnectorIndex_].bidirectional;
-        after["color"] = connectors_[selectedConnectorIndex_].color.name();
-        after["width"] = connectors_[selectedConnectorIndex_].width;
+        after["bidirectional"] = doc_.connectors[selectedConnectorIndex_].bidirectional;
+        after["color"] = doc_.connectors[selectedConnectorIndex_].color.name();
+        after["width"] = doc_.connectors[selectedConnectorIndex_].width;
         
         // 查找连接线的源和目标图形索引
-        int srcIndex = -1, dstIndex = -1;
-        for (size_t i = 0; i < shapes_.size(); ++i) {
-            if (shapes_[i].get() == connectors_[selectedConnectorIndex_].src) srcIndex = i;
-            if (shapes_[i].get() == connectors_[selectedConnectorIndex_].dst) dstIndex = i;
-        }
+        int srcIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].src);
+        int dstIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].dst);
         
         // 记录属性修改操作
         ActionRecord record;
@@ -1884,20 +2597,17 @@ void FlowView::setConnectorBidirectional(bool bidirectional)
         record.srcIndex = srcIndex;
         record.dstIndex = dstIndex;
         
-        if (!isUndoRedoing_) {
-            undoStack_.push(record);
-            clearRedoHistory();
-        }
+        doc_.pushAction(record);
         
-        update();
+        invalidateContent();
     }
 }
 
 // 切换连接线箭头方向
 void FlowView::toggleConnectorDirection()
 {
-    if (selectedConnectorIndex_ >= 0 && selectedConnectorIndex_ < connectors_.size()) {
-        Connector& conn = connectors_[selectedConnectorIndex_];
+    if (selectedConnectorIndex_ >= 0 && selectedConnectorIndex_ < doc_.connectors.size()) {
+        Connector& conn = doc_.connectors[selectedConnectorIndex_];
         
         // 记录修改前的状态和源目标索引
         QJsonObject before;
@@ -1905,11 +2615,8 @@ void FlowView::toggleConnectorDirection()
         before["color"] = conn.color.name();
         before["width"] = conn.width;
         
-        int oldSrcIndex = -1, oldDstIndex = -1;
-        for (size_t i = 0; i < shapes_.size(); ++i) {
-            if (shapes_[i].get() == conn.src) oldSrcIndex = i;
-            if (shapes_[i].get() == conn.dst) oldDstIndex = i;
-        }
+        int oldSrcIndex = doc_.indexOf(conn.src);
+        int oldDstIndex = doc_.indexOf(conn.dst);
         
         // 交换起点和终点
         std::swap(conn.src, conn.dst);
@@ -1920,11 +2627,8 @@ void FlowView::toggleConnectorDirection()
         after["color"] = conn.color.name();
         after["width"] = conn.width;
         
-        int newSrcIndex = -1, newDstIndex = -1;
-        for (size_t i = 0; i < shapes_.size(); ++i) {
-            if (shapes_[i].get() == conn.src) newSrcIndex = i;
-            if (shapes_[i].get() == conn.dst) newDstIndex = i;
-        }
+        int newSrcIndex = doc_.indexOf(conn.src);
+        int newDstIndex = doc_.indexOf(conn.dst);
         
         // 记录属性修改操作
         ActionRecord record;
@@ -1935,12 +2639,9 @@ void FlowView::toggleConnectorDirection()
         record.srcIndex = oldSrcIndex;
         record.dstIndex = oldDstIndex;
         
-        if (!isUndoRedoing_) {
-            undoStack_.push(record);
-            clearRedoHistory();
-        }
+        doc_.pushAction(record);
         
-        update();
+        invalidateContent();
     }
 }
 
@@ -1951,25 +2652,22 @@ void FlowView::setConnectorColor(const QColor& c)
     
     // 记录修改前的状态
     QJsonObject before;
-    before["bidirectional"] = connectors_[selectedConnectorIndex_].bidirectional;
-    before["color"] = connectors_[selectedConnectorIndex_].color.name();
-    before["width"] = connectors_[selectedConnectorIndex_].width;
+    before["bidirectional"] = doc_.connectors[selectedConnectorIndex_].bidirectional;
+    before["color"] = doc_.connectors[selectedConnectorIndex_].color.name();
+    before["width"] = doc_.connectors[selectedConnectorIndex_].width;
     
     // 执行修改
-    connectors_[selectedConnectorIndex_].color = c;
+    doc_.connectors[selectedConnectorIndex_].color = c;
     
     // 记录修改后的状态
     QJsonObject after;
-    after["bidirectional"] = connectors_[selectedConnectorIndex_].bidirectional;
-    after["color"] = connectors_[selectedConnectorIndex_].color.name();
-    after["width"] = connectors_[selectedConnectorIndex_].width;
+    after["bidirectional"] = doc_.connectors[selectedConnectorIndex_].bidirectional;
+    after["color"] = doc_.connectors[selectedConnectorIndex_].color.name();
+    after["width"] = doc_.connectors[selectedConnectorIndex_].width;
     
     // 查找连接线的源和目标图形索引
-    int srcIndex = -1, dstIndex = -1;
-    for (size_t i = 0; i < shapes_.size(); ++i) {
-        if (shapes_[i].get() == connectors_[selectedConnectorIndex_].src) srcIndex = i;
-        if (shapes_[i].get() == connectors_[selectedConnectorIndex_].dst) dstIndex = i;
-    }
+    int srcIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].src);
+    int dstIndex = doc_.indexOf(doc_.connectors[selectedConnectorIndex_].dst);
     
     // 记录属性修改操作
     ActionRecord record;
@@ -1980,414 +2678,31 @@ void FlowView::setConnectorColor(const QColor& c)
     record.srcIndex = srcIndex;
     record.dstIndex = dstIndex;
     
-    if (!isUndoRedoing_) {
-        undoStack_.push(record);
-        clearRedoHistory();
-    }
+    doc_.pushAction(record);
     
     // 更新UI
     emit connectorColorChanged(c);
-    update();
-}
-
-// 记录操作历史
-void FlowView::recordAction(ActionType type, int elementIndex, const QJsonObject& before, const QJsonObject& after)
-{
-    if (isUndoRedoing_) return; // 如果是在执行撤销/重做操作，不记录
-    
-    ActionRecord record;
-    record.type = type;
-    record.elementIndex = elementIndex;
-    record.stateBefore = before;
-    record.stateAfter = after;
-    
-    undoStack_.push(record);
-    clearRedoHistory(); // 有新操作时清空重做历史
-}
-
-// 记录连接线操作历史
-void FlowView::recordConnectorAction(ActionType type, int connIndex, int srcIndex, int dstIndex)
-{
-    if (isUndoRedoing_) return;
-    
-    ActionRecord record;
-    record.type = type;
-    record.elementIndex = connIndex;
-    record.srcIndex = srcIndex;
-    record.dstIndex = dstIndex;
-    
-    if (type == ActionType::AddConn) {
-        // 添加连接线操作，记录连接线的属性
-        if (connIndex >= 0 && connIndex < connectors_.size()) {
-            QJsonObject connObj;
-            connObj["color"] = connectors_[connIndex].color.name();
-            connObj["width"] = connectors_[connIndex].width;
-            connObj["bidirectional"] = connectors_[connIndex].bidirectional;
-            record.stateAfter = connObj;
-        }
-    } else if (type == ActionType::DeleteConn) {
-        // 删除连接线操作，记录被删除连接线的属性
-        if (connIndex >= 0 && connIndex < connectors_.size()) {
-            QJsonObject connObj;
-            connObj["color"] = connectors_[connIndex].color.name();
-            connObj["width"] = connectors_[connIndex].width;
-            connObj["bidirectional"] = connectors_[connIndex].bidirectional;
-            record.stateBefore = connObj;
-        }
-    }
-    
-    undoStack_.push(record);
-    clearRedoHistory();
-}
-
-// 清空重做历史
-void FlowView::clearRedoHistory()
-{
-    while (!redoStack_.empty()) {
-        redoStack_.pop();
-    }
+    invalidateContent();
 }
 
 // 撤销操作
 void FlowView::undo()
 {
-    if (undoStack_.empty()) return;
-    
-    isUndoRedoing_ = true;
-    ActionRecord record = undoStack_.top();
-    undoStack_.pop();
-    
-    switch (record.type) {
-        case ActionType::Add:
-            // 撤销添加图形操作（删除图形）
-            if (record.elementIndex >= 0 && record.elementIndex < shapes_.size()) {
-                shapes_.erase(shapes_.begin() + record.elementIndex);
-                if (selectedIndex_ == record.elementIndex) {
-                    selectedIndex_ = -1;
-                } else if (selectedIndex_ > record.elementIndex) {
-                    selectedIndex_--;
-                }
-            }
-            break;
-            
-        case ActionType::Delete:
-            // 撤销删除图形操作（重新添加图形）
-            {
-                std::unique_ptr<Shape> s;
-                QString type = record.stateBefore["type"].toString();
-                if (type == "rect")         s = std::make_unique<Rect>();
-                else if (type == "ellipse") s = std::make_unique<Ellipse>();
-                else if (type == "diamond") s = std::make_unique<Diamond>();
-                else if (type == "triangle") s = std::make_unique<Triangle>();
-                else if (type == "pentagon") s = std::make_unique<Pentagon>();
-                else if (type == "hexagon") s = std::make_unique<Hexagon>();
-                else if (type == "octagon") s = std::make_unique<Octagon>();
-                else if (type == "roundedrect") s = std::make_unique<RoundedRect>();
-                else if (type == "capsule") s = std::make_unique<Capsule>();
-                else if (type == "recttriangle") s = std::make_unique<RectTriangle>();
-                
-                if (s) {
-                    s->fromJson(record.stateBefore);
-                    if (record.elementIndex >= 0 && record.elementIndex <= shapes_.size()) {
-                        shapes_.insert(shapes_.begin() + record.elementIndex, std::move(s));
-                        if (selectedIndex_ >= record.elementIndex) {
-                            selectedIndex_++;
-                        }
-                    } else {
-                        shapes_.push_back(std::move(s));
-                    }
-                }
-            }
-            break;
-        
-        case ActionType::Move:
-        case ActionType::Resize:
-        case ActionType::Property:
-            // 撤销移动/调整大小/属性修改操作（恢复到之前的状态）
-            if (record.elementIndex >= 0 && record.elementIndex < shapes_.size()) {
-                QString type = shapes_[record.elementIndex]->toJson()["type"].toString();
-                std::unique_ptr<Shape> s;
-                if (type == "rect")         s = std::make_unique<Rect>();
-                else if (type == "ellipse") s = std::make_unique<Ellipse>();
-                else if (type == "diamond") s = std::make_unique<Diamond>();
-                else if (type == "triangle") s = std::make_unique<Triangle>();
-                else if (type == "pentagon") s = std::make_unique<Pentagon>();
-                else if (type == "hexagon") s = std::make_unique<Hexagon>();
-                else if (type == "octagon") s = std::make_unique<Octagon>();
-                else if (type == "roundedrect") s = std::make_unique<RoundedRect>();
-                else if (type == "capsule") s = std::make_unique<Capsule>();
-                else if (type == "recttriangle") s = std::make_unique<RectTriangle>();
-                
-                if (s) {
-                    s->fromJson(record.stateBefore);
-                    Shape* oldShape = shapes_[record.elementIndex].get();
-                    shapes_[record.elementIndex] = std::move(s);
-                    
-                    // 更新所有指向这个图形的连接线
-                    for (auto& conn : connectors_) {
-                        if (conn.src == oldShape) {
-                            conn.src = shapes_[record.elementIndex].get();
-                        }
-                        if (conn.dst == oldShape) {
-                            conn.dst = shapes_[record.elementIndex].get();
-                        }
-                    }
-                }
-            } else if (record.elementIndex >= 0 && record.elementIndex < connectors_.size()) {
-                // 处理连接线属性的撤销
-                if (record.stateBefore.contains("color"))
-                    connectors_[record.elementIndex].color = QColor(record.stateBefore["color"].toString());
-                if (record.stateBefore.contains("width"))
-                    connectors_[record.elementIndex].width = record.stateBefore["width"].toDouble(2.0);
-                if (record.stateBefore.contains("bidirectional"))
-                    connectors_[record.elementIndex].bidirectional = record.stateBefore["bidirectional"].toBool();
-                
-                // 如果源和目标发生了变化
-                if (record.srcIndex >= 0 && record.srcIndex < shapes_.size())
-                    connectors_[record.elementIndex].src = shapes_[record.srcIndex].get();
-                if (record.dstIndex >= 0 && record.dstIndex < shapes_.size())
-                    connectors_[record.elementIndex].dst = shapes_[record.dstIndex].get();
-            }
-            break;
-            
-        case ActionType::ZOrder:
-            // 撤销层级调整操作
-            if (record.stateBefore.contains("index") && record.stateAfter.contains("index")) {
-                int oldIndex = record.stateBefore["index"].toInt();
-                int newIndex = record.stateAfter["index"].toInt();
-                
-                if (newIndex >= 0 && newIndex < shapes_.size()) {
-                    // 将图形从当前位置移回原来的位置
-                    auto tmp = std::move(shapes_[newIndex]);
-                    shapes_.erase(shapes_.begin() + newIndex);
-                    
-                    // 确保oldIndex在有效范围内
-                    int insertPos = qBound(0, oldIndex, static_cast<int>(shapes_.size()));
-                    shapes_.insert(shapes_.begin() + insertPos, std::move(tmp));
-                    
-                    // 更新选中索引
-                    selectedIndex_ = insertPos;
-                }
-            }
-            break;
-            
-        case ActionType::AddConn:
-            // 撤销添加连接线操作（删除连接线）
-            if (record.elementIndex >= 0 && record.elementIndex < connectors_.size()) {
-                connectors_.erase(connectors_.begin() + record.elementIndex);
-                if (selectedConnectorIndex_ == record.elementIndex) {
-                    selectedConnectorIndex_ = -1;
-                } else if (selectedConnectorIndex_ > record.elementIndex) {
-                    selectedConnectorIndex_--;
-                }
-            }
-            break;
-            
-        case ActionType::DeleteConn:
-            // 撤销删除连接线操作（重新添加连接线）
-            if (record.srcIndex >= 0 && record.srcIndex < shapes_.size() &&
-                record.dstIndex >= 0 && record.dstIndex < shapes_.size()) {
-                Connector conn;
-                conn.src = shapes_[record.srcIndex].get();
-                conn.dst = shapes_[record.dstIndex].get();
-                
-                // 恢复连接线属性
-                if (record.stateBefore.contains("color"))
-                    conn.color = QColor(record.stateBefore["color"].toString());
-                if (record.stateBefore.contains("width"))
-                    conn.width = record.stateBefore["width"].toDouble(2.0);
-                if (record.stateBefore.contains("bidirectional"))
-                    conn.bidirectional = record.stateBefore["bidirectional"].toBool();
-                
-                if (record.elementIndex >= 0 && record.elementIndex <= connectors_.size()) {
-                    connectors_.insert(connectors_.begin() + record.elementIndex, conn);
-                    if (selectedConnectorIndex_ >= record.elementIndex) {
-                        selectedConnectorIndex_++;
-                    }
-                } else {
-                    connectors_.push_back(conn);
-                }
-            }
-            break;
-    }
-    
-    // 将动作放入重做栈
-    redoStack_.push(record);
-    
+    if (loading_) return;
+    if (!doc_.undo(selectedIndex_, selectedConnectorIndex_)) return;
+
     // 更新UI
     updatePropertyPanel();
-    update();
-    isUndoRedoing_ = false;
+    invalidateContent();
 }
 
 // 重做操作
 void FlowView::redo()
 {
-    if (redoStack_.empty()) return;
-    
-    isUndoRedoing_ = true;
-    ActionRecord record = redoStack_.top();
-    redoStack_.pop();
-    
-    switch (record.type) {
-        case ActionType::Add:
-            // 重做添加图形操作
-            {
-                std::unique_ptr<Shape> s;
-                QString type = record.stateAfter["type"].toString();
-                if (type == "rect")         s = std::make_unique<Rect>();
-                else if (type == "ellipse") s = std::make_unique<Ellipse>();
-                else if (type == "diamond") s = std::make_unique<Diamond>();
-                else if (type == "triangle") s = std::make_unique<Triangle>();
-                else if (type == "pentagon") s = std::make_unique<Pentagon>();
-                else if (type == "hexagon") s = std::make_unique<Hexagon>();
-                else if (type == "octagon") s = std::make_unique<Octagon>();
-                else if (type == "roundedrect") s = std::make_unique<RoundedRect>();
-                else if (type == "capsule") s = std::make_unique<Capsule>();
-                else if (type == "recttriangle") s = std::make_unique<RectTriangle>();
-                
-                if (s) {
-                    s->fromJson(record.stateAfter);
-                    if (record.elementIndex >= 0 && record.elementIndex <= shapes_.size()) {
-                        shapes_.insert(shapes_.begin() + record.elementIndex, std::move(s));
-                        if (selectedIndex_ >= record.elementIndex) {
-                            selectedIndex_++;
-                        }
-                    } else {
-                        shapes_.push_back(std::move(s));
-                    }
-                }
-            }
-            break;
-            
-        case ActionType::Delete:
-            // 重做删除图形操作
-            if (record.elementIndex >= 0 && record.elementIndex < shapes_.size()) {
-                shapes_.erase(shapes_.begin() + record.elementIndex);
-                if (selectedIndex_ == record.elementIndex) {
-                    selectedIndex_ = -1;
-                } else if (selectedIndex_ > record.elementIndex) {
-                    selectedIndex_--;
-                }
-            }
-            break;
-            
-        case ActionType::Move:
-        case ActionType::Resize:
-        case ActionType::Property:
-            // 重做移动/调整大小/属性修改操作
-            if (record.elementIndex >= 0 && record.elementIndex < shapes_.size()) {
-                QString type = shapes_[record.elementIndex]->toJson()["type"].toString();
-                std::unique_ptr<Shape> s;
-                if (type == "rect")         s = std::make_unique<Rect>();
-                else if (type == "ellipse") s = std::make_unique<Ellipse>();
-                else if (type == "diamond") s = std::make_unique<Diamond>();
-                else if (type == "triangle") s = std::make_unique<Triangle>();
-                else if (type == "pentagon") s = std::make_unique<Pentagon>();
-                else if (type == "hexagon") s = std::make_unique<Hexagon>();
-                else if (type == "octagon") s = std::make_unique<Octagon>();
-                else if (type == "roundedrect") s = std::make_unique<RoundedRect>();
-                else if (type == "capsule") s = std::make_unique<Capsule>();
-                else if (type == "recttriangle") s = std::make_unique<RectTriangle>();
-                
-                if (s) {
-                    s->fromJson(record.stateAfter);
-                    Shape* oldShape = shapes_[record.elementIndex].get();
-                    shapes_[record.elementIndex] = std::move(s);
-                    
-                    // 更新所有指向这个图形的连接线
-                    for (auto& conn : connectors_) {
-                        if (conn.src == oldShape) {
-                            conn.src = shapes_[record.elementIndex].get();
-                        }
-                        if (conn.dst == oldShape) {
-                            conn.dst = shapes_[record.elementIndex].get();
-                        }
-                    }
-                }
-            } else if (record.elementIndex >= 0 && record.elementIndex < connectors_.size()) {
-                // 处理连接线属性的重做
-                if (record.stateAfter.contains("color"))
-                    connectors_[record.elementIndex].color = QColor(record.stateAfter["color"].toString());
-                if (record.stateAfter.contains("width"))
-                    connectors_[record.elementIndex].width = record.stateAfter["width"].toDouble(2.0);
-                if (record.stateAfter.contains("bidirectional"))
-                    connectors_[record.elementIndex].bidirectional = record.stateAfter["bidirectional"].toBool();
-                
-                // 如果源和目标发生了变化
-                if (record.srcIndex >= 0 && record.srcIndex < shapes_.size())
-                    connectors_[record.elementIndex].src = shapes_[record.srcIndex].get();
-                if (record.dstIndex >= 0 && record.dstIndex < shapes_.size())
-                    connectors_[record.elementIndex].dst = shapes_[record.dstIndex].get();
-            }
-            break;
-            
-        case ActionType::ZOrder:
-            // 重做层级调整操作
-            if (record.stateBefore.contains("index") && record.stateAfter.contains("index")) {
-                int oldIndex = record.stateBefore["index"].toInt();
-                int newIndex = record.stateAfter["index"].toInt();
-                
-                if (oldIndex >= 0 && oldIndex < shapes_.size()) {
-                    // 将图形从原来位置移动到新位置
-                    auto tmp = std::move(shapes_[oldIndex]);
-                    shapes_.erase(shapes_.begin() + oldIndex);
-                    
-                    // 确保newIndex在有效范围内
-                    int insertPos = qBound(0, newIndex, static_cast<int>(shapes_.size()));
-                    shapes_.insert(shapes_.begin() + insertPos, std::move(tmp));
-                    
-                    // 更新选中索引
-                    selectedIndex_ = insertPos;
-                }
-            }
-            break;
-            
-        case ActionType::AddConn:
-            // 重做添加连接线操作
-            if (record.srcIndex >= 0 && record.srcIndex < shapes_.size() &&
-                record.dstIndex >= 0 && record.dstIndex < shapes_.size()) {
-                Connector conn;
-                conn.src = shapes_[record.srcIndex].get();
-                conn.dst = shapes_[record.dstIndex].get();
-                
-                // 恢复连接线属性
-                if (record.stateAfter.contains("color"))
-                    conn.color = QColor(record.stateAfter["color"].toString());
-                if (record.stateAfter.contains("width"))
-                    conn.width = record.stateAfter["width"].toDouble(2.0);
-                if (record.stateAfter.contains("bidirectional"))
-                    conn.bidirectional = record.stateAfter["bidirectional"].toBool();
-                
-                if (record.elementIndex >= 0 && record.elementIndex <= connectors_.size()) {
-                    connectors_.insert(connectors_.begin() + record.elementIndex, conn);
-                    if (selectedConnectorIndex_ >= record.elementIndex) {
-                        selectedConnectorIndex_++;
-                    }
-                } else {
-                    connectors_.push_back(conn);
-                }
-            }
-            break;
-            
-        case ActionType::DeleteConn:
-            // 重做删除连接线操作
-            if (record.elementIndex >= 0 && record.elementIndex < connectors_.size()) {
-                connectors_.erase(connectors_.begin() + record.elementIndex);
-                if (selectedConnectorIndex_ == record.elementIndex) {
-                    selectedConnectorIndex_ = -1;
-                } else if (selectedConnectorIndex_ > record.elementIndex) {
-                    selectedConnectorIndex_--;
-                }
-            }
-            break;
-    }
-    
-    // 将动作放回撤销栈
-    undoStack_.push(record);
-    
+    if (loading_) return;
+    if (!doc_.redo(selectedIndex_, selectedConnectorIndex_)) return;
+
     // 更新UI
     updatePropertyPanel();
-    update();
-    isUndoRedoing_ = false;
+    invalidateContent();
 }
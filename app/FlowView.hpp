@@ -1,9 +1,12 @@
 #pragma once
+#include <QPixmap>
+#include <QRegion>
+#include <QTimer>
 #include <QWidget>
 #include <vector>
 #include <memory>
-#include <stack>
 
+#include "model/Document.hpp"     // 文档模型（图形、连接线、页面设置、撤销历史）
 #include "model/Shape.hpp"
 #include "model/Rect.hpp"
 #include "model/Ellipse.hpp"
@@ -11,30 +14,12 @@
 #include "model/Capsule.hpp"
 #include "model/RectTriangle.hpp"
 #include "model/Connector.hpp"     // 所有连接线
-
-// 操作类型枚举
-enum class ActionType {
-    Add,        // 添加图形
-    Delete,     // 删除图形
-    Move,       // 移动图形
-    Resize,     // 调整大小
-    Property,   // 修改属性
-    ZOrder,     // 调整层级
-    AddConn,    // 添加连接线
-    DeleteConn  // 删除连接线
-};
-
-// 历史操作记录结构
-struct ActionRecord {
-    ActionType type;                         // 操作类型
-    int elementIndex;                        // 操作元素的索引
-    QJsonObject stateBefore;                 // 操作前的状态
-    QJsonObject stateAfter;                  // 操作后的状态
-    
-    // 连接线相关信息
-    int srcIndex = -1;                       // 连接线起点索引
-    int dstIndex = -1;                       // 连接线终点索引
-};
+#include "RenderStats.hpp"         // 渲染统计面板
+#include "LatencyTracker.hpp"      // 输入到画面的延迟统计
+#include "DocumentLoader.hpp"      // 后台渐进加载
+#include "JournalCompactor.hpp"    // 编辑日志的后台合并
+#include "AutoSaver.hpp"           // 后台自动保存
+#include "io/Journal.hpp"          // 追加式编辑日志
 
 class FlowView : public QWidget
 {
@@ -46,9 +31,16 @@ signals:
     void textColorChanged(const QColor& color);  // 文本颜色变化信号
     void textSizeChanged(int size);  // 文本大小变化信号
     void connectorColorChanged(const QColor& color);  // 连接线颜色变化信号
+    void loadProgress(int percent);           // 后台加载进度（0-100）
+    void loadFinished(bool ok);               // 后台加载结束
+    void loadCancelled();                     // 后台加载被新的操作取消（新建、重新打开等）
+    void viewChanged();                       // 缩放比例、偏移量或窗口大小改变
+    void documentReset();                     // 整个文档被替换（新建、打开、加载失败恢复）
+    void contentChanged(const QRectF& area);  // 文档中的一块区域在编辑记录之外改变（后台加载）
 
 public:
     explicit FlowView(QWidget* parent = nullptr);
+    ~FlowView() override;
 
     /* ---------- 工具模式 ---------- */
     enum class ToolMode { None, DrawRect, DrawEllipse, DrawDiamond, DrawConnector, DrawTriangle, DrawPentagon, DrawHexagon, DrawOctagon, DrawRoundedRect, DrawCapsule, DrawRectTriangle };
@@ -56,10 +48,23 @@ public:
 
     /* ---------- 文件操作 ---------- */
 public:
-    // 保存当前绘图到文件
+    // 把当前绘图完整写入文件（另存为），之后的编辑记录到该文件的日志中
     bool saveToFile(const QString& filename);
+    // 保存到当前文件：只在编辑日志中写入保存标记，耗时与改动量成正比
+    bool save();
+    // 当前文档对应的文件，新建的文档为空
+    QString currentFile() const { return currentFile_; }
     // 从文件加载绘图
     bool loadFromFile(const QString& filename);
+    // 在后台线程中渐进加载，加载期间可以平移/缩放浏览已加载的部分，结果通过 loadFinished 通知
+    void openFileAsync(const QString& filename);
+    bool isLoading() const { return loading_; }
+    // 后台打开自动保存的恢复文件，source 为它所属的文档（新建的文档为空）
+    void openRecoveryAsync(const QString& recoveryFile, const QString& source);
+    // 自动保存设置修改后调用
+    void applyAutosaveSettings() { autosaver_->applySettings(); }
+    // 当前文档的自动保存恢复文件
+    QString autosaveFile() const { return autosaver_->recoveryFile(); }
     // 导出为PNG图片
     bool exportToPng(const QString& filename);
     // 导出为SVG
@@ -72,9 +77,27 @@ public:
     void setPageSize(int width, int height);
     void setGridVisible(bool visible);
     
-    QColor backgroundColor() const { return backgroundColor_; }
-    QSize pageSize() const { return pageSize_; }
-    bool isGridVisible() const { return showGrid_; }
+    QColor backgroundColor() const { return doc_.backgroundColor; }
+    QSize pageSize() const { return doc_.pageSize; }
+    bool isGridVisible() const { return doc_.showGrid; }
+    
+    // 当前文档（只读）
+    const Document& document() const { return doc_; }
+    // 注册/移除文档的编辑观察者（概览面板按编辑记录增量更新）
+    void addEditObserver(EditObserver* observer) { doc_.addObserver(observer); }
+    void removeEditObserver(EditObserver* observer) { doc_.removeObserver(observer); }
+    // 当前可见的文档区域
+    QRectF visibleDocRect() const;
+    // 平移视图，使文档坐标 docPos 位于窗口中央
+    void centerOn(const QPointF& docPos);
+    // 交互延迟统计（只读）
+    const LatencyTracker& latency() const { return latency_; }
+
+    // 细节层次设置（保存在 QSettings 中，启动时读取）
+    static LodOptions lodSettings();
+    const LodOptions& levelOfDetail() const { return lod_; }
+    // 保存设置并重绘
+    void setLevelOfDetail(const LodOptions& lod);
 
     /* ---------- 编辑器 / Z-Order 接口 ---------- */
 public slots:
@@ -101,7 +124,7 @@ public slots:
     void toggleConnectorDirection();
     void setConnectorColor(const QColor& c);
 
-    void updateConnectorsFor(Shape* movedShape);
+    void updateConnectorsFor(const Shape* movedShape);
 
     void bringToFront();
     void sendToBack();
@@ -119,6 +142,9 @@ public slots:
     void undo();
     void redo();
 
+    // 渲染统计面板（F12）
+    void setStatsOverlayVisible(bool visible);
+
 protected:
     /* ---------- Qt 事件 ---------- */
     void paintEvent(QPaintEvent*) override;
@@ -127,6 +153,8 @@ protected:
     void mouseReleaseEvent(QMouseEvent*) override;
     void mouseDoubleClickEvent(QMouseEvent*) override;
     void wheelEvent(QWheelEvent*) override;  // 处理鼠标滚轮事件
+    void resizeEvent(QResizeEvent*) override;
+    void leaveEvent(QEvent*) override;
 
     void dragEnterEvent(QDragEnterEvent*) override;
     void dropEvent(QDropEvent*) override;
@@ -141,6 +169,8 @@ protected:
     QPointF docToView(const QPointF& docPoint) const;
     // 绘制页面边界
     void drawPageBorder(QPainter& painter);
+    // 文档坐标是否在页面内（无边界画布总是在页面内）
+    bool isOnPage(const QPointF& docPos) const;
     
     // 调整大小相关功能
     enum class ResizeHandle {
@@ -162,20 +192,14 @@ protected:
     
     // 查找点击了哪个连接线
     int hitTestConnector(const QPointF& pt) const;
-    
-    // 记录操作历史
-    void recordAction(ActionType type, int elementIndex, const QJsonObject& before, const QJsonObject& after);
-    // 记录连接线操作历史
-    void recordConnectorAction(ActionType type, int connIndex, int srcIndex, int dstIndex);
-    // 清空重做历史
-    void clearRedoHistory();
+    // 查找点击了哪个图形（从最上层开始），exclude 为需要跳过的图形
+    int hitTestShape(const QPointF& docPos, const Shape* exclude = nullptr) const;
 
 private:
     /* ---------- 数据成员 ---------- */
     ToolMode mode_ = ToolMode::None;
 
-    std::vector<std::unique_ptr<Shape>> shapes_; // 所有图形元素
-    std::vector<Connector> connectors_;          // 所有连接线
+    Document doc_;                               // 图形、连接线、页面设置和撤销历史
     Connector currentConn_;                      // 当前正在绘制的临时连接线
     
     int     selectedIndex_ = -1;   // 选中的图形索引
@@ -185,20 +209,138 @@ private:
     // 调整大小相关
     ResizeHandle resizeHandle_ = ResizeHandle::None;
     
-    // 页面设置
-    QColor backgroundColor_ = QColor("#fdfdfd");  // 背景颜色
-    QSize pageSize_ = QSize(2000, 2000);          // 页面大小
-    bool showGrid_ = true;                        // 是否显示网格
-    
     // 视图变换
     qreal scale_ = 1.0;            // 缩放比例
     QPointF viewOffset_ = {0, 0};  // 视图偏移量
     bool isPanning_ = false;       // 正在平移视图
     QPointF lastPanPoint_;         // 上次平移点
     
-    // 操作历史记录
-    std::stack<ActionRecord> undoStack_;         // 撤销栈
-    std::stack<ActionRecord> redoStack_;         // 重做栈
-    bool isUndoRedoing_ = false;                 // 是否正在执行撤销/重做操作
     QJsonObject lastShapeState_;                 // 上一次操作前的图形状态
+
+    /* ---------- 后台加载 ---------- */
+    void applyLoadedData();                      // 把加载线程交付的内容合并进文档
+    void finishLoad(bool ok);
+    void endLoad(bool ok);                       // 结束加载状态，失败时恢复原文档
+    void cancelLoad();                           // 取消加载，丢弃已加载的部分
+    void panBy(const QPointF& delta);            // 平移视图：移动已绘制的画面，只重绘新露出的部分
+
+    // 加载期间暂存的原文档，加载失败时恢复
+    struct StashedDocument {
+        ShapeList shapes;
+        QVector<Connector> connectors;
+        QColor backgroundColor;
+        QSize pageSize;
+        bool showGrid = true;
+    };
+
+    DocumentLoader* loader_ = nullptr;
+    bool loading_ = false;
+    std::vector<int> loadOrder_;                 // 加载期间 doc_.shapes 中各图形在文件中的索引（递增）
+    std::unique_ptr<StashedDocument> stash_;
+    QString loadingFile_;                        // 正在后台加载的文件
+    QString recoverySource_;                     // 正在加载恢复文件时，它所属的文档
+    bool loadingRecovery_ = false;
+
+    /* ---------- 编辑日志 ---------- */
+    void openJournal(const QString& filename);   // 文档加载后回放日志（崩溃后询问是否恢复），并继续记录
+    void closeJournal();                         // 关闭当前文档的日志：已保存的记录合并回文件，未保存的丢弃
+    void finishCompaction(const QString& docFile, const QString& compactFile, int records, bool ok);
+
+    Journal journal_;                            // 当前文档的编辑日志
+    JournalCompactor* compactor_ = nullptr;
+    QTimer  compactTimer_;                       // 保存后空闲一段时间，把不足合并阈值的已保存记录也合并回文件
+    QString currentFile_;                        // 当前文档对应的文件
+    AutoSaver* autosaver_ = nullptr;             // 没有编辑日志记录的文档（新建、日志不可写）由它自动保存
+
+    LodOptions lod_;                             // 细节层次：缩小后简化小图形的绘制
+
+    /* ---------- 交互画质 ---------- */
+    // 手势（拖拽、平移、缩放）进行中：完整画质一帧超出预算时改为快速绘制，
+    // 输入空闲一段时间后再绘制一帧完整画质
+    void beginGesture();
+    void endGesture();
+
+    QTimer gestureIdleTimer_;
+    bool   gestureActive_ = false;
+    bool   lastFrameFast_ = false;               // 上一帧是快速绘制的
+    bool   staleFrame_ = false;                  // 画面中还有没重绘完的部分
+    qint64 fullFrameNs_ = 0;                     // 最近一帧完整画质的绘制耗时
+
+    /* ---------- 平滑缩放 ---------- */
+    // 以 anchor（视图坐标）为中心缩放；手势进行中只缩放手势开始时截取的画面
+    void zoomAt(qreal factor, const QPointF& anchor);
+    // 缩放结束后按新比例逐块重绘，离 anchor 近的块先画
+    void startTiles(const QPoint& anchor);
+    void renderTiles();
+
+    QPixmap zoomFrame_;                          // 缩放手势开始时的画面
+    qreal   zoomFrameScale_ = 1.0;               // 截取画面时的缩放比例和偏移量
+    QPointF zoomFrameOffset_;
+    QPoint  zoomAnchor_;                         // 最近一次缩放的中心
+    bool    grabbingFrame_ = false;
+    std::vector<QRect> tiles_;                   // 等待重绘的块（最后一个最先画）
+    QTimer  tileTimer_;
+
+    /* ---------- 内容缓存与覆盖层 ---------- */
+    // 页面、网格、连接线和图形画在内容缓存中；悬停高亮、正在绘制的连接线、选中框和控制柄
+    // 每帧画在缓存之上，选中或悬停改变时只需把缓存贴出来再画覆盖层
+    void invalidateContent();                    // 文档内容改变，下一帧重绘缓存
+    void invalidateContent(const QRectF& docRect); // 只重绘缓存中的一块文档区域
+
+    struct ContentCache {
+        QPixmap pixmap;                          // 按窗口大小和设备像素比绘制的内容
+        QRegion dirty;                           // 已经过期的部分（视图坐标）
+        QRegion fast;                            // 快速绘制的部分，完整画质的一帧中重画
+        qreal   scale = 0;                       // 对应的缩放比例和偏移量
+        QPointF offset;
+    };
+    ContentCache content_;
+    ContentCache spareContent_;                  // 窗口移到像素比不同的屏幕时，上一个屏幕的缓存
+    qint64       cacheBudget_ = 0;               // 缓存的内存预算（字节）
+    static qint64 cacheBudgetBytes();            // 读取设置中的内存预算（cache/budgetMB）
+    qreal cachePixelRatio() const;               // 缓存使用的像素比：屏幕的像素比，超出预算时降低
+    int     hoverIndex_ = -1;                    // 光标下的图形
+
+    /* ---------- 分片绘制 ---------- */
+    // 缓存中过期的部分按层级顺序分片绘制，每片不超过时间预算；一片画不完时先显示已画好的部分，
+    // 其余的片通过事件循环继续绘制，期间仍然可以处理输入。内容或视图改变时放弃，下次需要显示时重新开始
+    struct RenderJob {
+        bool       active = false;
+        QRegion    region;                       // 正在绘制的缓存区域（视图坐标）
+        QRegion    clip;                         // 实际绘制的区域（有页面时限制在页面内）
+        QRectF     visibleDoc;                   // region 对应的文档区域
+        LodOptions lod;
+        bool       fast = false;
+        int        nextConnector = 0;            // 下一片从这里继续
+        int        nextShape = 0;
+        int        connectorsDrawn = 0;
+        int        shapesDrawn = 0;
+        qint64     elapsedNs = 0;                // 各片累计的绘制时间
+    };
+    void startRender(const QRegion& region, const LodOptions& lod, bool fast);  // 画背景、网格和第一片
+    bool renderSlice(qint64 budgetNs);           // 继续绘制，全部画完时返回 true
+    void continueRender();                       // 事件循环中绘制下一片
+    void cancelRender();
+
+    RenderJob job_;
+    QRegion   renderPending_;                    // 被打断或推迟、下一帧需要画的过期部分
+    QTimer    sliceTimer_;
+
+    /* ---------- 拖动预览 ---------- */
+    // 拖动开始时把其余内容冻结在缓存中，拖动期间只在覆盖层中画移动的图形（预先画好的贴图）
+    // 和连在它上面的连接线；拖动结束后把图形画回缓存
+    void beginDrag();
+    void endDrag();
+    QRectF dragArea(const Shape* shape) const;   // 图形及其连接线占据的文档区域
+    const Shape* draggedShape() const;           // 拖动中的图形，没有拖动时为空
+
+    bool    dragging_ = false;
+    int     dragIndex_ = -1;                     // 拖动中的图形
+    QPixmap dragSprite_;                         // 拖动开始时画好的图形
+    QPointF dragSpriteOffset_;                   // 贴图左上角相对图形外框左上角的位置（文档坐标）
+    qreal   dragSpriteScale_ = 0;                // 画贴图时的缩放比例
+
+    bool showStats_ = false;                     // 是否显示渲染统计面板
+    mutable RenderStats stats_;                  // 渲染统计（命中测试在 const 函数中计数）
+    LatencyTracker latency_;                     // 各类交互的输入到画面延迟
 };
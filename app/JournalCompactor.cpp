@@ -0,0 +1,46 @@
+#include "JournalCompactor.hpp"
+#include "io/Journal.hpp"
+
+#include <QFile>
+#include <QMetaObject>
+
+JournalCompactor::JournalCompactor(QObject* parent)
+    : QObject(parent)
+{
+}
+
+JournalCompactor::~JournalCompactor()
+{
+    cancel();
+}
+
+void JournalCompactor::start(const QString& docFile, int records)
+{
+    if (running_) return;
+
+    running_ = true;
+    ok_ = false;
+    compactFile_.clear();
+    const int generation = ++generation_;
+
+    thread_ = std::thread([this, docFile, records, generation]() {
+        ok_ = Journal::compact(docFile, records, compactFile_);
+
+        QMetaObject::invokeMethod(this, [this, docFile, records, generation]() {
+            if (generation != generation_) return;   // 已取消，临时文件由 cancel 删除
+            if (thread_.joinable()) thread_.join();
+            running_ = false;
+            emit finished(docFile, compactFile_, records, ok_);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void JournalCompactor::cancel()
+{
+    ++generation_;
+    if (thread_.joinable()) {
+        thread_.join();
+        if (ok_) QFile::remove(compactFile_);   // 文档已关闭或另存，合并结果作废
+    }
+    running_ = false;
+}
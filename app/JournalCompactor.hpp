@@ -0,0 +1,32 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <thread>
+
+/* 在后台线程中把编辑日志中已保存的记录合并回基础文件（见 Journal）
+   合并只读取文件，不接触正在编辑的文档；完成后在 GUI 线程中通过 finished 通知，
+   由调用方执行 Journal::finishCompaction 替换基础文件。 */
+class JournalCompactor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JournalCompactor(QObject* parent = nullptr);
+    ~JournalCompactor() override;
+
+    // 开始合并 docFile 日志中的前 records 条记录（正在合并时忽略）
+    void start(const QString& docFile, int records);
+    // 等待合并线程结束并丢弃结果（关闭或另存文档之前调用）
+    void cancel();
+    bool isRunning() const { return running_; }
+
+signals:
+    void finished(const QString& docFile, const QString& compactFile, int records, bool ok);
+
+private:
+    std::thread thread_;
+    bool        running_ = false;
+    bool        ok_ = false;         // 以下两项由合并线程写入，join 之后读取
+    QString     compactFile_;
+    int         generation_ = 0;   // 只在 GUI 线程中读写，用于丢弃过期的结果
+};
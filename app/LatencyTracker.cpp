@@ -0,0 +1,87 @@
+#include "LatencyTracker.hpp"
+
+#include <algorithm>
+
+LatencyTracker::LatencyTracker()
+{
+    clock_.start();
+}
+
+void LatencyTracker::markInput(Operation op, qint64 arrivalNs)
+{
+    Samples& s = ops_[op];
+    if (s.pending < 0) s.pending = arrivalNs;
+}
+
+void LatencyTracker::frameCompleted()
+{
+    const qint64 t = now();
+    for (Samples& s : ops_) {
+        if (s.pending < 0) continue;
+        s.ms[s.pos] = static_cast<float>((t - s.pending) / 1.0e6);
+        s.pos = (s.pos + 1) % SampleCapacity;
+        s.count = std::min(s.count + 1, SampleCapacity);
+        s.pending = -1;
+    }
+}
+
+LatencyTracker::Summary LatencyTracker::summary(Operation op) const
+{
+    const Samples& s = ops_[op];
+    Summary result;
+    result.samples = s.count;
+    if (s.count == 0) return result;
+
+    std::vector<float> sorted(s.ms.begin(), s.ms.begin() + s.count);
+    auto percentile = [&sorted](double q) {
+        size_t k = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        return static_cast<double>(sorted[k]);
+    };
+    result.p50 = percentile(0.50);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    result.max = *std::max_element(sorted.begin(), sorted.end());
+    return result;
+}
+
+const char* LatencyTracker::operationName(Operation op)
+{
+    static const char* names[OperationCount] = {
+        "drag", "resize", "pan", "zoom", "connector"
+    };
+    return names[op];
+}
+
+QStringList LatencyTracker::summaryLines() const
+{
+    QStringList lines;
+    for (int i = 0; i < OperationCount; ++i) {
+        Summary s = summary(static_cast<Operation>(i));
+        if (s.samples == 0) continue;
+        lines << QString("  %1 %2 %3 %4 ms")
+                     .arg(QString(operationName(static_cast<Operation>(i))), -10)
+                     .arg(s.p50, 5, 'f', 1)
+                     .arg(s.p95, 5, 'f', 1)
+                     .arg(s.p99, 5, 'f', 1);
+    }
+    return lines;
+}
+
+QString LatencyTracker::report() const
+{
+    QString text = QString("%1 %2 %3 %4 %5 %6\n")
+                       .arg("operation", -10).arg("samples", 8)
+                       .arg("p50 ms", 8).arg("p95 ms", 8).arg("p99 ms", 8).arg("max ms", 8);
+    for (int i = 0; i < OperationCount; ++i) {
+        Summary s = summary(static_cast<Operation>(i));
+        text += QString("%1 %2 %3 %4 %5 %6\n")
+                    .arg(QString(operationName(static_cast<Operation>(i))), -10)
+                    .arg(s.samples, 8)
+                    .arg(s.p50, 8, 'f', 2)
+                    .arg(s.p95, 8, 'f', 2)
+                    .arg(s.p99, 8, 'f', 2)
+                    .arg(s.max, 8, 'f', 2);
+    }
+    return text;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <vector>
+
+/* 输入到画面（input-to-photon）延迟统计：
+   从鼠标/滚轮事件到达处理函数开始，到反映该输入的下一次 paintEvent 结束为止。
+   同一帧之前合并的多个输入以最早到达的那个计时，即用户实际感受到的最长等待。 */
+class LatencyTracker
+{
+public:
+    // 按交互类型分别统计
+    enum Operation {
+        Drag,        // 拖拽移动图形
+        Resize,      // 调整大小（控制柄或新建图形时拖出尺寸）
+        Pan,         // 平移视图（空格抓取或滚轮滚动）
+        Zoom,        // 缩放
+        Connector,   // 连接线橡皮筋
+        OperationCount
+    };
+
+    // 某一类交互的延迟分布（毫秒）
+    struct Summary {
+        int    samples = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    LatencyTracker();
+
+    // 输入事件到达时刻（纳秒），在事件处理函数入口取得
+    qint64 now() const { return clock_.nsecsElapsed(); }
+    // 标记一次输入，arrivalNs 为 now() 的返回值
+    void markInput(Operation op, qint64 arrivalNs);
+    // 一帧绘制完成：为所有等待中的输入记录延迟
+    void frameCompleted();
+
+    Summary summary(Operation op) const;
+    static const char* operationName(Operation op);
+
+    // 叠加面板和基准输出使用的文本（每种有样本的交互一行）
+    QStringList summaryLines() const;
+    // 完整报告，没有样本的交互也列出
+    QString report() const;
+
+    static constexpr int SampleCapacity = 1024;   // 每种交互保留的最近样本数
+
+private:
+    // 每种交互的样本环形缓冲
+    struct Samples {
+        std::array<float, SampleCapacity> ms{};
+        int    count = 0;      // 已写入的样本数（不超过容量）
+        int    pos = 0;        // 下一次写入的位置
+        qint64 pending = -1;   // 尚未绘制的最早输入时刻，-1 表示没有
+    };
+
+    QElapsedTimer clock_;
+    std::array<Samples, OperationCount> ops_;
+};
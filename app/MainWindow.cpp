@@ -1,7 +1,13 @@
 ﻿#include "MainWindow.hpp"
 #include "FlowView.hpp"
 #include "PropertyPanel.hpp"
+#include "Minimap.hpp"
+#include "AutoSaver.hpp"
+#include "io/Journal.hpp"
+#include "trace/Trace.hpp"
 #include <QMenuBar>
+#include <QStatusBar>
+#include <QProgressBar>
 #include <QToolBar>
 #include <QShortcut> 
 #include <QDockWidget>
@@ -15,6 +21,13 @@
 #include <QMessageBox>
 #include <QToolButton>
 #include <QMenu>
+#include <QLocale>
+#include <QTimer>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QtMath>
 #include <QDebug>
 
 MainWindow::MainWindow(QWidget* parent)
@@ -27,32 +40,97 @@ MainWindow::MainWindow(QWidget* parent)
     auto* view = new FlowView(this);   // 新建画布
     setCentralWidget(view);            // 设为中心部件
 
+    /* ---------- Status Bar ---------- */
+    // 后台打开文件时显示加载进度，加载期间画布可以平移浏览已加载的部分
+    auto* loadProgress = new QProgressBar;
+    loadProgress->setRange(0, 100);
+    loadProgress->setMaximumWidth(200);
+    loadProgress->setTextVisible(true);
+    loadProgress->hide();
+    statusBar()->addPermanentWidget(loadProgress);
+    connect(view, &FlowView::loadProgress, loadProgress, &QProgressBar::setValue);
+    connect(view, &FlowView::loadCancelled, loadProgress, &QWidget::hide);
+    connect(view, &FlowView::loadFinished, this, [this, loadProgress](bool ok) {
+        loadProgress->hide();
+        if (ok) {
+            statusBar()->showMessage(tr("File loaded"), 3000);
+        } else {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot open file"));
+        }
+    });
+
     /* ---------- Menu ---------- */
     auto fileMenu = menuBar()->addMenu(tr("File"));
     fileMenu->addAction(tr("New\tCtrl+N"), this, [this, view]() {
         view->clearAll();
     });
     
-    fileMenu->addAction(tr("Open\tCtrl+O"), this, [this, view]() {
+    // 打开：文档有异常退出时留下的自动保存恢复文件时，询问是否从恢复文件打开
+    auto open = [this, view, loadProgress]() {
         QString filename = QFileDialog::getOpenFileName(
             this, tr("Open Flowchart"), QString(), 
-            tr("Flowchart Files (*.flow);;All Files (*.*)"));
-        if (!filename.isEmpty()) {
-            if (!view->loadFromFile(filename)) {
-                QMessageBox::warning(this, tr("Error"), tr("Cannot open file"));
-            }
+            tr("Flowchart Files (*.flow *.fdb *.fdz);;All Files (*.*)"));
+        if (filename.isEmpty()) return;
+
+        const AutoSaver::RecoveryFile recovery = AutoSaver::recoveryFileFor(filename);
+        if (recovery.path.isEmpty() || recovery.path == view->autosaveFile()) {
+            view->openFileAsync(filename);   // 后台渐进加载，结果在 loadFinished 中处理
+        } else if (Journal::inspect(filename).unsavedRecords > 0) {
+            // 编辑日志逐条记录了未保存的编辑，比恢复文件更新，打开时由日志恢复
+            AutoSaver::discard(recovery.path);
+            view->openFileAsync(filename);
+        } else if (QMessageBox::question(this, tr("Recover"),
+                       tr("An autosaved version of this file from %1 was found.\n"
+                          "Open the autosaved version?")
+                           .arg(QLocale().toString(recovery.saved, QLocale::ShortFormat)))
+                   == QMessageBox::Yes) {
+            view->openRecoveryAsync(recovery.path, filename);
+        } else {
+            AutoSaver::discard(recovery.path);
+            view->openFileAsync(filename);
         }
-    });
+        loadProgress->setValue(0);
+        loadProgress->show();
+    };
+    fileMenu->addAction(tr("Open\tCtrl+O"), this, open);
     
-    fileMenu->addAction(tr("Save\tCtrl+S"), this, [this, view]() {
+    // 另存为：完整写出文件；保存：已有文件时只在编辑日志中追加保存标记
+    auto saveAs = [this, view]() {
         QString filename = QFileDialog::getSaveFileName(
-            this, tr("Save Flowchart"), QString(), 
-            tr("Flowchart Files (*.flow)"));
+            this, tr("Save Flowchart"), view->currentFile(), 
+            tr("Flowchart Files (*.flow);;Binary Flowchart Files (*.fdb);;Compressed Flowchart Files (*.fdz)"));
         if (!filename.isEmpty()) {
             if (!view->saveToFile(filename)) {
                 QMessageBox::warning(this, tr("Error"), tr("Cannot save file"));
             }
         }
+    };
+    auto save = [this, view, saveAs]() {
+        if (view->currentFile().isEmpty()) {
+            saveAs();
+        } else if (view->save()) {
+            statusBar()->showMessage(tr("Saved"), 2000);
+        } else {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot save file"));
+        }
+    };
+    fileMenu->addAction(tr("Save\tCtrl+S"), this, save);
+    fileMenu->addAction(tr("Save As...\tCtrl+Shift+S"), this, saveAs);
+    
+    fileMenu->addAction(tr("Autosave Settings..."), this, [this, view]() {
+        AutoSaver::Settings settings = AutoSaver::settings();
+        bool ok = false;
+        const int interval = QInputDialog::getInt(this, tr("Autosave Settings"),
+            tr("Autosave interval in seconds (0 = off):"), settings.intervalSeconds, 0, 3600, 10, &ok);
+        if (!ok) return;
+        settings.intervalSeconds = interval;
+        if (interval > 0) {
+            const QString current = settings.directory.isEmpty() ? AutoSaver::defaultDirectory() : settings.directory;
+            const QString dir = QFileDialog::getExistingDirectory(this, tr("Autosave Location"), current);
+            if (!dir.isEmpty()) settings.directory = dir;   // 取消时保留原来的目录
+        }
+        AutoSaver::setSettings(settings);
+        view->applyAutosaveSettings();   // 新目录从下一个文档开始使用
     });
     
     fileMenu->addSeparator();
@@ -123,6 +201,22 @@ MainWindow::MainWindow(QWidget* parent)
     });
     gridAction->setCheckable(true);
     gridAction->setChecked(view->isGridVisible());  // 设置初始状态
+
+    // 无边界画布：没有页面边框，文档范围随内容扩展；关闭时恢复能容纳全部内容的页面
+    auto unboundedAction = pageMenu->addAction(tr("Unbounded Canvas"));
+    unboundedAction->setCheckable(true);
+    connect(unboundedAction, &QAction::triggered, view, [view](bool checked) {
+        if (checked) {
+            view->setPageSize(0, 0);
+            return;
+        }
+        const QRectF content = view->document().contentBounds();
+        view->setPageSize(qMax(2000, qCeil(content.right())), qMax(2000, qCeil(content.bottom())));
+    });
+    // 打开其他文档后页面模式可能改变，显示菜单时再同步状态
+    connect(pageMenu, &QMenu::aboutToShow, unboundedAction, [view, unboundedAction]() {
+        unboundedAction->setChecked(view->document().isUnbounded());
+    });
     
     // 添加视图菜单
     auto viewMenu = menuBar()->addMenu(tr("View"));
@@ -130,6 +224,79 @@ MainWindow::MainWindow(QWidget* parent)
     viewMenu->addAction(tr("Zoom Out\tCtrl+-"), view, &FlowView::zoomOut);
     viewMenu->addAction(tr("Reset Zoom\tCtrl+0"), view, &FlowView::resetZoom);
     viewMenu->addAction(tr("Fit to Window\tCtrl+F"), view, &FlowView::fitToWindow);
+    viewMenu->addSeparator();
+    // 细节层次：缩小后小图形不画文字、用矩形或点代替，连接线不画箭头
+    auto lodAction = viewMenu->addAction(tr("Level of Detail"));
+    lodAction->setCheckable(true);
+    lodAction->setChecked(view->levelOfDetail().enabled);
+    connect(lodAction, &QAction::toggled, view, [view](bool checked) {
+        LodOptions lod = view->levelOfDetail();
+        lod.enabled = checked;
+        view->setLevelOfDetail(lod);
+    });
+    viewMenu->addAction(tr("Level of Detail Settings..."), this, [this, view, lodAction]() {
+        QDialog dlg(this);
+        dlg.setWindowTitle(tr("Level of Detail"));
+        auto* form = new QFormLayout(&dlg);
+        auto pixels = [this, &dlg](qreal value) {
+            auto* box = new QDoubleSpinBox(&dlg);
+            box->setRange(0, 1000);
+            box->setDecimals(1);
+            box->setSuffix(tr(" px"));
+            box->setValue(value);
+            return box;
+        };
+        LodOptions lod = view->levelOfDetail();
+        auto* text = pixels(lod.textPixels);
+        auto* shape = pixels(lod.shapePixels);
+        auto* point = pixels(lod.pointPixels);
+        auto* arrow = pixels(lod.arrowPixels);
+        form->addRow(tr("Hide text below:"), text);
+        form->addRow(tr("Draw shapes as rectangles below:"), shape);
+        form->addRow(tr("Draw shapes as points below:"), point);
+        form->addRow(tr("Hide arrowheads below:"), arrow);
+        auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+        connect(buttons, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+        form->addRow(buttons);
+        if (dlg.exec() != QDialog::Accepted) return;
+
+        lod.textPixels = text->value();
+        lod.shapePixels = shape->value();
+        lod.pointPixels = point->value();
+        lod.arrowPixels = arrow->value();
+        lod.enabled = true;
+        view->setLevelOfDetail(lod);
+        lodAction->setChecked(true);
+    });
+    viewMenu->addSeparator();
+    // 渲染统计面板：各图层耗时、帧率、绘制数量等
+    auto statsAction = viewMenu->addAction(tr("Render Statistics\tF12"));
+    statsAction->setCheckable(true);
+    connect(statsAction, &QAction::toggled, view, &FlowView::setStatsOverlayVisible);
+    new QShortcut(QKeySequence(Qt::Key_F12), this, [statsAction]() { statsAction->toggle(); });
+
+    // 性能跟踪：记录 Chrome/Perfetto trace-event JSON，可在 ui.perfetto.dev 中查看
+    auto traceAction = viewMenu->addAction(tr("Record Performance Trace..."));
+    traceAction->setCheckable(true);
+    traceAction->setChecked(Tracer::enabled());   // FLOWDRAW_TRACE 环境变量已开启时
+    connect(traceAction, &QAction::triggered, this, [this, traceAction](bool checked) {
+        if (!checked) {
+            QString filename = Tracer::currentFile();
+            Tracer::stop();
+            QMessageBox::information(this, tr("Performance Trace"),
+                tr("Trace written to %1").arg(filename));
+            return;
+        }
+        QString filename = QFileDialog::getSaveFileName(
+            this, tr("Record Performance Trace"), "flowdraw-trace.json",
+            tr("Trace Files (*.json)"));
+        if (filename.isEmpty() || !Tracer::start(filename)) {
+            if (!filename.isEmpty())
+                QMessageBox::warning(this, tr("Error"), tr("Cannot write trace file"));
+            traceAction->setChecked(false);
+        }
+    });
 
     /* ---------- Toolbar ---------- */
     auto toolBar = addToolBar(tr("Tools"));
@@ -430,6 +597,13 @@ MainWindow::MainWindow(QWidget* parent)
     paletteDock->setWidget(palette);
     addDockWidget(Qt::LeftDockWidgetArea, paletteDock);
 
+    /* ---------- Overview Dock ---------- */
+    // 整个页面的缩略图，拖动其中的矩形平移画布
+    auto overviewDock = new QDockWidget(tr("Overview"), this);
+    overviewDock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
+    overviewDock->setWidget(new Minimap(view, overviewDock));
+    addDockWidget(Qt::LeftDockWidgetArea, overviewDock);
+
     
 
     
@@ -500,25 +674,29 @@ MainWindow::MainWindow(QWidget* parent)
     
     // 添加文件操作快捷键
     new QShortcut(QKeySequence("Ctrl+N"), this, [this, view]() { view->clearAll(); });
-    new QShortcut(QKeySequence("Ctrl+O"), this, [this, view]() {
-        QString filename = QFileDialog::getOpenFileName(
-            this, tr("Open Flowchart"), QString(), 
-            tr("Flowchart Files (*.flow);;All Files (*.*)"));
-        if (!filename.isEmpty()) {
-            if (!view->loadFromFile(filename)) {
-                QMessageBox::warning(this, tr("Error"), tr("Cannot open file"));
-            }
+    new QShortcut(QKeySequence("Ctrl+O"), this, open);
+    new QShortcut(QKeySequence("Ctrl+S"), this, save);
+    new QShortcut(QKeySequence("Ctrl+Shift+S"), this, saveAs);
+
+    // 启动时检查上次异常退出时留下的新建文档（有所属文件的恢复文件在打开该文件时处理）
+    QTimer::singleShot(0, this, [this, view, loadProgress]() {
+        QList<AutoSaver::RecoveryFile> untitled;
+        for (const AutoSaver::RecoveryFile& file : AutoSaver::recoveryFiles()) {
+            if (file.source.isEmpty() && file.path != view->autosaveFile()) untitled.push_back(file);
         }
-    });
-    new QShortcut(QKeySequence("Ctrl+S"), this, [this, view]() {
-        QString filename = QFileDialog::getSaveFileName(
-            this, tr("Save Flowchart"), QString(), 
-            tr("Flowchart Files (*.flow)"));
-        if (!filename.isEmpty()) {
-            if (!view->saveToFile(filename)) {
-                QMessageBox::warning(this, tr("Error"), tr("Cannot save file"));
-            }
+        if (untitled.isEmpty()) return;
+
+        const AutoSaver::RecoveryFile& latest = untitled.front();
+        if (QMessageBox::question(this, tr("Recover"),
+                tr("FlowDraw did not exit normally. Recover the unsaved document from %1?")
+                    .arg(QLocale().toString(latest.saved, QLocale::ShortFormat)))
+            == QMessageBox::Yes) {
+            view->openRecoveryAsync(latest.path, QString());
+            loadProgress->setValue(0);
+            loadProgress->show();
+            untitled.pop_front();
         }
+        for (const AutoSaver::RecoveryFile& file : untitled) AutoSaver::discard(file.path);
     });
 }
 
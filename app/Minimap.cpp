@@ -0,0 +1,267 @@
+#include "Minimap.hpp"
+#include "FlowView.hpp"
+#include "trace/Trace.hpp"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <cmath>
+
+namespace {
+
+constexpr int   RefreshDelayMs = 50;     // 编辑后稍等再重绘，合并连续的多次编辑
+constexpr int   MaxDirtyRects = 32;      // 脏区域过多时合并为一个外接矩形
+constexpr qreal DirtyMargin = 16;        // 描边宽度和箭头的余量（文档坐标）
+constexpr qreal PageMargin = 4;          // 页面与面板边缘的距离（像素）
+constexpr qreal ContentMargin = 40;      // 无边界画布中内容四周留出的空白（文档坐标）
+constexpr qreal ExtentStep = 250;        // 无边界画布的显示范围按该步长（或内容尺寸的 1/4）向外取整
+
+// 图形状态中的外框，不是图形状态时为空
+QRectF stateBounds(const QJsonObject& state)
+{
+    if (!state.contains("x")) return QRectF();
+    return QRectF(state["x"].toDouble(), state["y"].toDouble(),
+                  state["w"].toDouble(), state["h"].toDouble()).normalized();
+}
+
+} // namespace
+
+Minimap::Minimap(FlowView* view, QWidget* parent)
+    : QWidget(parent)
+    , view_(view)
+{
+    setMinimumSize(120, 120);
+    setCursor(Qt::PointingHandCursor);
+
+    refreshTimer_.setSingleShot(true);
+    refreshTimer_.setInterval(RefreshDelayMs);
+    connect(&refreshTimer_, &QTimer::timeout, this, &Minimap::refresh);
+
+    view->addEditObserver(this);
+    connect(view, &FlowView::viewChanged, this, QOverload<>::of(&QWidget::update));
+    connect(view, &FlowView::documentReset, this, &Minimap::invalidateAll);
+    connect(view, &FlowView::contentChanged, this, &Minimap::invalidate);
+}
+
+Minimap::~Minimap()
+{
+    if (view_) view_->removeEditObserver(this);
+}
+
+void Minimap::actionApplied(const ActionRecord& record, bool forward)
+{
+    if (!view_) return;
+    const Document& doc = view_->document();
+    auto shapeAt = [&doc](int index) -> const Shape* {
+        return index >= 0 && index < doc.shapes.size() ? doc.shapes[index] : nullptr;
+    };
+
+    // 修改前后的外框
+    QRectF area = stateBounds(record.stateBefore) | stateBounds(record.stateAfter);
+    const Shape* changed = nullptr;
+    switch (record.type) {
+        case ActionType::AddConn:
+        case ActionType::DeleteConn:
+            // 连接线总在两端图形的外接矩形内
+            for (int index : {record.srcIndex, record.dstIndex}) {
+                if (const Shape* s = shapeAt(index)) area |= s->bounds.normalized();
+            }
+            break;
+
+        case ActionType::ZOrder: {
+            const int index = (forward ? record.stateAfter : record.stateBefore)["index"].toInt(-1);
+            if (const Shape* s = shapeAt(index)) area |= s->bounds.normalized();
+            break;
+        }
+
+        case ActionType::Move:
+        case ActionType::Resize:
+        case ActionType::Property:
+            changed = shapeAt(record.elementIndex);
+            break;
+
+        default:
+            break;
+    }
+
+    // 相连的连接线随图形一起移动
+    if (changed) {
+        for (const Connector& c : doc.connectors) {
+            if ((c.src == changed || c.dst == changed) && c.src && c.dst) {
+                area |= c.src->bounds.normalized() | c.dst->bounds.normalized();
+            }
+        }
+    }
+
+    if (area.isNull()) {
+        invalidateAll();
+    } else {
+        invalidate(area);
+    }
+}
+
+void Minimap::pageChanged(const QColor&, const QSize&, bool)
+{
+    invalidateAll();
+}
+
+void Minimap::invalidateAll()
+{
+    fullDirty_ = true;
+    dirty_.clear();
+    refreshTimer_.start();
+}
+
+void Minimap::invalidate(const QRectF& docRect)
+{
+    if (fullDirty_) return;
+    dirty_.push_back(docRect.adjusted(-DirtyMargin, -DirtyMargin, DirtyMargin, DirtyMargin));
+    if (dirty_.size() > MaxDirtyRects) {
+        QRectF merged;
+        for (const QRectF& r : dirty_) merged |= r;
+        dirty_ = {merged};
+    }
+    if (!refreshTimer_.isActive()) refreshTimer_.start();
+}
+
+QRectF Minimap::documentExtent() const
+{
+    if (!view_) return QRectF();
+    const Document& doc = view_->document();
+    if (!doc.isUnbounded()) return doc.pageRect();
+    if (content_.isNull()) return QRectF(0, 0, 1000, 1000);
+
+    // 向外取整到较粗的步长：内容在余量内变化时范围不变，不必整页重绘
+    const QRectF r = content_.adjusted(-ContentMargin, -ContentMargin, ContentMargin, ContentMargin);
+    const qreal step = qMax(ExtentStep, qMax(r.width(), r.height()) / 4);
+    return QRectF(QPointF(std::floor(r.left() / step) * step, std::floor(r.top() / step) * step),
+                  QPointF(std::ceil(r.right() / step) * step, std::ceil(r.bottom() / step) * step));
+}
+
+QRectF Minimap::pageArea() const
+{
+    const QSizeF page = extent_.size();
+    if (!view_ || page.isEmpty()) return QRectF();
+
+    const QRectF avail = QRectF(rect()).adjusted(PageMargin, PageMargin, -PageMargin, -PageMargin);
+    const qreal s = qMin(avail.width() / page.width(), avail.height() / page.height());
+    const QSizeF size = page * s;
+    return QRectF(avail.center() - QPointF(size.width() / 2, size.height() / 2), size);
+}
+
+QPointF Minimap::toDoc(const QPointF& pos) const
+{
+    const QRectF area = pageArea();
+    return extent_.topLeft() + QPointF((pos.x() - area.left()) * extent_.width() / area.width(),
+                                       (pos.y() - area.top()) * extent_.height() / area.height());
+}
+
+void Minimap::refresh()
+{
+    if (!view_) return;
+    const Document& doc = view_->document();
+    /* 无边界画布的范围随内容变化。内容范围只在整页重绘时完整计算一次（遍历所有图形），
+       编辑时用脏区域扩大；内容超出当前的显示范围时才换成新的范围并整页重绘 */
+    if (doc.isUnbounded()) {
+        if (fullDirty_) {
+            content_ = doc.contentBounds();
+        } else {
+            for (const QRectF& r : dirty_) content_ |= r;
+        }
+        const QRectF needed = content_.adjusted(-ContentMargin, -ContentMargin, ContentMargin, ContentMargin);
+        if (fullDirty_ || !extent_.contains(needed)) {
+            extent_ = documentExtent();
+            fullDirty_ = true;
+        }
+    } else if (extent_ != doc.pageRect()) {
+        extent_ = doc.pageRect();
+        fullDirty_ = true;
+    }
+    const QRectF area = pageArea();
+    if (area.isEmpty()) return;
+
+    TraceSpan span("Minimap::refresh", "paint");
+    const qreal dpr = devicePixelRatioF();
+    const QSize size = (area.size() * dpr).toSize();
+    if (cache_.size() != size) fullDirty_ = true;
+
+    if (fullDirty_) {
+        cache_ = QImage(size, QImage::Format_ARGB32_Premultiplied);
+        dirty_ = {extent_};
+        fullDirty_ = false;
+    }
+    span.arg("regions", dirty_.size());
+
+    QPainter p(&cache_);
+    p.scale(size.width() / extent_.width(), size.height() / extent_.height());
+    p.translate(-extent_.topLeft());
+    const qreal pixel = extent_.width() / size.width();   // 一个缓存像素对应的文档长度
+
+    // 概览中图形只有几个像素，按细节层次绘制
+    LodOptions lod;
+    lod.enabled = true;
+    for (const QRectF& dirty : dirty_) {
+        const QRectF r = dirty.adjusted(-pixel, -pixel, pixel, pixel).intersected(extent_);
+        if (r.isEmpty()) continue;
+        p.save();
+        p.setClipRect(r);
+        p.fillRect(r, doc.backgroundColor);
+        doc.drawConnectors(p, r, lod);
+        doc.drawShapes(p, -1, r, lod);
+        p.restore();
+    }
+    dirty_.clear();
+    update();
+}
+
+void Minimap::paintEvent(QPaintEvent*)
+{
+    QPainter p(this);
+    p.fillRect(rect(), palette().window());
+
+    const QRectF area = pageArea();
+    if (!view_ || area.isEmpty()) return;
+
+    // 窗口移到像素比不同的屏幕后按新的像素比重绘
+    if (!cache_.isNull() && cache_.size() != (area.size() * devicePixelRatioF()).toSize()
+        && !refreshTimer_.isActive()) {
+        invalidateAll();
+    }
+
+    // 整页重绘之前先显示旧的缓存（窗口大小或像素比改变时会被拉伸）
+    if (cache_.isNull()) {
+        p.fillRect(area, view_->document().backgroundColor);
+    } else {
+        p.drawImage(area, cache_);
+    }
+    p.setPen(Qt::gray);
+    p.setBrush(Qt::NoBrush);
+    p.drawRect(area);
+
+    // 画布当前可见的区域
+    const qreal s = area.width() / extent_.width();
+    const QRectF visible = view_->visibleDocRect();
+    const QRectF viewport(area.topLeft() + (visible.topLeft() - extent_.topLeft()) * s, visible.size() * s);
+    p.setPen(QPen(QColor(220, 40, 40), 1.5));
+    p.setBrush(QColor(220, 40, 40, 30));
+    p.drawRect(viewport);
+}
+
+void Minimap::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    invalidateAll();
+}
+
+void Minimap::mousePressEvent(QMouseEvent* event)
+{
+    if (view_ && event->button() == Qt::LeftButton) {
+        view_->centerOn(toDoc(event->pos()));
+    }
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent* event)
+{
+    if (view_ && (event->buttons() & Qt::LeftButton)) {
+        view_->centerOn(toDoc(event->pos()));
+    }
+}
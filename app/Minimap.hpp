@@ -0,0 +1,53 @@
+#pragma once
+#include <QImage>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <QWidget>
+
+#include "model/History.hpp"
+
+class FlowView;
+
+/* 概览面板：缩小显示整个页面，并用矩形标出画布当前可见的区域，拖动矩形即可平移画布
+
+   页面预先按面板大小渲染到一张低分辨率的缓存图中（按细节层次绘制，小图形只画点或矩形），
+   平移和缩放画布时只重新贴图、画可见区域的矩形。编辑时作为 EditObserver 只把受影响的
+   区域（修改前后的外框以及相连的连接线）记为脏区域，稍后统一重绘这些区域；只有整个文档
+   被替换或页面设置改变时才重绘整页。无边界画布显示按粗步长取整的内容范围，内容超出
+   该范围时才重绘整页；编辑时内容范围由脏区域逐步扩大，不遍历所有图形。 */
+class Minimap : public QWidget, public EditObserver
+{
+    Q_OBJECT
+
+public:
+    explicit Minimap(FlowView* view, QWidget* parent = nullptr);
+    ~Minimap() override;
+
+    QSize sizeHint() const override { return QSize(220, 220); }
+
+    void actionApplied(const ActionRecord& record, bool forward) override;
+    void pageChanged(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) override;
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+    void resizeEvent(QResizeEvent*) override;
+    void mousePressEvent(QMouseEvent*) override;
+    void mouseMoveEvent(QMouseEvent*) override;
+
+private:
+    void invalidateAll();                        // 整页重绘缓存
+    void invalidate(const QRectF& docRect);      // 重绘文档中的一块区域
+    void refresh();                              // 把积累的脏区域画进缓存
+    QRectF documentExtent() const;               // 概览显示的文档范围
+    QRectF pageArea() const;                     // 文档范围在面板中的位置
+    QPointF toDoc(const QPointF& pos) const;     // 面板坐标转换为文档坐标
+
+    QPointer<FlowView> view_;
+    QRectF          extent_;                     // 缓存对应的文档范围（页面或无边界画布的内容范围）
+    QRectF          content_;                    // 无边界画布的内容范围（编辑后只扩大，整页重绘时重新计算）
+    QImage          cache_;                      // 整个文档范围的低分辨率渲染
+    bool            fullDirty_ = true;
+    QVector<QRectF> dirty_;                      // 等待重绘的文档区域
+    QTimer          refreshTimer_;               // 合并短时间内的多次编辑
+};
@@ -0,0 +1,128 @@
+#include "RenderStats.hpp"
+
+#include <QFontDatabase>
+#include <QPainter>
+#include <algorithm>
+
+RenderStats::RenderStats()
+{
+    clock_.start();
+}
+
+void RenderStats::beginFrame()
+{
+    layerNs_.fill(0);
+}
+
+void RenderStats::addLayerTime(Layer layer, qint64 nsecs)
+{
+    layerNs_[layer] += nsecs;
+}
+
+void RenderStats::endFrame(qint64 frameNs, const DocInfo& info)
+{
+    lastLayerNs_ = layerNs_;
+    lastFrameNs_ = frameNs;
+    info_ = info;
+
+    // 写入帧耗时环形缓冲
+    frameMs_[historyPos_] = static_cast<float>(frameNs / 1.0e6);
+    historyPos_ = (historyPos_ + 1) % HistorySize;
+
+    // 只保留最近一秒内的帧完成时刻
+    const qint64 now = clock_.elapsed();
+    frameTimes_.push_back(now);
+    while (!frameTimes_.empty() && now - frameTimes_.front() > 1000) {
+        frameTimes_.pop_front();
+    }
+
+    updateHitTestRate();
+}
+
+double RenderStats::framesPerSecond() const
+{
+    if (frameTimes_.size() < 2) return 0;
+    qint64 span = frameTimes_.back() - frameTimes_.front();
+    if (span <= 0) return 0;
+    return (frameTimes_.size() - 1) * 1000.0 / span;
+}
+
+void RenderStats::updateHitTestRate()
+{
+    // 每隔半秒结算一次命中测试频率
+    const qint64 now = clock_.elapsed();
+    const qint64 span = now - hitWindowStart_;
+    if (span >= 500) {
+        hitTestsPerSecond_ = hitTests_ * 1000.0 / span;
+        hitTests_ = 0;
+        hitWindowStart_ = now;
+    }
+}
+
+void RenderStats::draw(QPainter& p, const QPoint& topLeft, const QStringList& extraLines)
+{
+    static const char* layerNames[LayerCount] = {
+        "background", "grid", "connectors", "shapes", "handles"
+    };
+
+    QStringList lines;
+    lines << QString("frame      %1 ms   %2 fps")
+                 .arg(lastFrameNs_ / 1.0e6, 0, 'f', 2)
+                 .arg(framesPerSecond(), 0, 'f', 1);
+    for (int i = 0; i < LayerCount; ++i) {
+        lines << QString("  %1 %2 ms")
+                     .arg(QString(layerNames[i]), -11)
+                     .arg(lastLayerNs_[i] / 1.0e6, 6, 'f', 2);
+    }
+    lines << QString("shapes     %1 / %2").arg(info_.shapesDrawn).arg(info_.shapesTotal);
+    lines << QString("connectors %1 / %2").arg(info_.connectorsDrawn).arg(info_.connectorsTotal);
+    lines << QString("hit tests  %1 /s").arg(hitTestsPerSecond_, 0, 'f', 0);
+    lines << QString("undo       %1 (~%2 KB)")
+                 .arg(info_.undoDepth)
+                 .arg(info_.historyBytes / 1024.0, 0, 'f', 1);
+    lines << extraLines;
+
+    p.save();
+    p.setRenderHint(QPainter::Antialiasing, false);
+
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setPointSize(9);
+    p.setFont(font);
+    const QFontMetrics fm(font);
+    const int lineHeight = fm.height();
+    const int histHeight = 48;
+    const int width = 2 * HistorySize + 16;
+    const int height = lines.size() * lineHeight + histHeight + 20;
+
+    // 半透明底板
+    QRect panel(topLeft, QSize(width, height));
+    p.setPen(Qt::NoPen);
+    p.setBrush(QColor(0, 0, 0, 170));
+    p.drawRect(panel);
+
+    // 文本
+    p.setPen(QColor(230, 230, 230));
+    int y = panel.top() + 6 + fm.ascent();
+    for (const QString& line : lines) {
+        p.drawText(panel.left() + 8, y, line);
+        y += lineHeight;
+    }
+
+    // 帧耗时直方图：每帧一根柱子，刻度上限 33ms，虚线为 16.7ms（60fps）预算
+    QRect hist(panel.left() + 8, panel.bottom() - histHeight - 6, 2 * HistorySize, histHeight);
+    p.setBrush(QColor(255, 255, 255, 30));
+    p.drawRect(hist);
+    const double maxMs = 33.3;
+    for (int i = 0; i < HistorySize; ++i) {
+        float ms = frameMs_[(historyPos_ + i) % HistorySize];
+        if (ms <= 0) continue;
+        int h = std::max(1, static_cast<int>(std::min(1.0, ms / maxMs) * histHeight));
+        QColor c = ms > 33.3 ? QColor(230, 60, 60) : ms > 16.7 ? QColor(240, 190, 40) : QColor(80, 200, 90);
+        p.fillRect(QRect(hist.left() + 2 * i, hist.bottom() - h + 1, 2, h), c);
+    }
+    int budgetY = hist.bottom() - static_cast<int>(16.7 / maxMs * histHeight);
+    p.setPen(QPen(QColor(255, 255, 255, 140), 1, Qt::DashLine));
+    p.drawLine(hist.left(), budgetY, hist.right(), budgetY);
+
+    p.restore();
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <deque>
+
+class QPainter;
+
+/* 画布渲染统计：记录每帧各图层耗时、帧率、绘制数量和命中测试频率，
+   并以半透明面板的形式叠加绘制在画布左上角 */
+class RenderStats
+{
+public:
+    // 参与计时的图层
+    enum Layer {
+        Background,   // 窗口背景与页面边框
+        Grid,         // 网格
+        Connectors,   // 连接线
+        Shapes,       // 图形
+        Handles,      // 调整大小控制柄
+        LayerCount
+    };
+
+    // 叠加面板中额外显示的文档信息
+    struct DocInfo {
+        int shapesDrawn = 0;
+        int shapesTotal = 0;
+        int connectorsDrawn = 0;
+        int connectorsTotal = 0;
+        int undoDepth = 0;
+        qint64 historyBytes = 0;
+    };
+
+    RenderStats();
+
+    // 开始一帧：重置各图层计时
+    void beginFrame();
+    // 记录图层耗时（纳秒）
+    void addLayerTime(Layer layer, qint64 nsecs);
+    // 结束一帧：记录整帧耗时（纳秒）并更新帧率窗口
+    void endFrame(qint64 frameNs, const DocInfo& info);
+
+    // 统计命中测试次数（每次调用 Shape::hitTest 或连接线距离计算记一次）
+    void countHitTests(int n = 1) { hitTests_ += n; }
+
+    // 绘制叠加面板（视图坐标），extraLines 追加在文档信息之后、直方图之前
+    void draw(QPainter& p, const QPoint& topLeft, const QStringList& extraLines = QStringList());
+
+    static constexpr int HistorySize = 120;   // 直方图保留的帧数
+
+private:
+    // 最近一秒内的帧率和命中测试频率
+    double framesPerSecond() const;
+    void   updateHitTestRate();
+
+    QElapsedTimer clock_;                        // 全局时钟，用于帧率统计
+    std::array<qint64, LayerCount> layerNs_{};   // 当前帧各图层耗时
+    std::array<qint64, LayerCount> lastLayerNs_{}; // 上一帧各图层耗时
+    qint64 lastFrameNs_ = 0;                     // 上一帧总耗时
+    std::array<float, HistorySize> frameMs_{};   // 帧耗时环形缓冲
+    int    historyPos_ = 0;                      // 环形缓冲写入位置
+    std::deque<qint64> frameTimes_;              // 最近一秒内每帧的完成时刻（毫秒）
+
+    DocInfo info_;
+    qint64 hitTests_ = 0;                        // 当前统计窗口内的命中测试次数
+    qint64 hitWindowStart_ = 0;                  // 统计窗口起始时刻
+    double hitTestsPerSecond_ = 0;
+};
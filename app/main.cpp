@@ -1,10 +1,16 @@
 #include <QApplication>
 #include "MainWindow.hpp"
+#include "trace/Trace.hpp"
 
 int main(int argc, char* argv[])
 {
     QApplication a(argc, argv);
+    QCoreApplication::setOrganizationName("FlowDraw");   // QSettings 和自动保存目录使用
+    QCoreApplication::setApplicationName("FlowDraw");
+    Tracer::startFromEnvironment();   // FLOWDRAW_TRACE=<文件名> 时记录性能跟踪
     MainWindow w;
     w.show();
-    return a.exec();
+    int ret = a.exec();
+    Tracer::stop();
+    return ret;
 }
@@ -0,0 +1,262 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "model/Document.hpp"
+#include "io/Journal.hpp"
+#include "trace/Trace.hpp"
+
+namespace {
+
+// 单个文件的转换任务
+struct ConvertJob {
+    QString input;
+    QString output;
+};
+
+// 解析 "x,y,w,h" 形式的区域参数
+bool parseRegion(const QString& text, QRectF& region)
+{
+    const QStringList parts = text.split(',');
+    if (parts.size() != 4) return false;
+
+    qreal v[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        v[i] = parts[i].trimmed().toDouble(&ok);
+        if (!ok) return false;
+    }
+
+    region = QRectF(v[0], v[1], v[2], v[3]);
+    return region.width() > 0 && region.height() > 0;
+}
+
+// 根据输出文件扩展名判断是否导出 SVG
+bool isSvgOutput(const QString& filename)
+{
+    return QFileInfo(filename).suffix().compare("svg", Qt::CaseInsensitive) == 0;
+}
+
+// 输出文件是否为文档格式（此时做格式转换而不是渲染）
+bool isDocumentOutput(const QString& filename)
+{
+    const QString suffix = QFileInfo(filename).suffix().toLower();
+    return suffix == "json" || suffix == "flow" || suffix == "fdb" || suffix == "fdz";
+}
+
+// 加载并渲染（或转换）一个文档，失败时写入错误信息
+bool convert(const ConvertJob& job, const RenderOptions& options, const SaveOptions& saveOptions, QString& error)
+{
+    TraceSpan span("convert", "cli");
+    span.arg("input", job.input);
+
+    Document doc;
+    if (!doc.loadFromFile(job.input)) {
+        error = QString("cannot load %1").arg(job.input);
+        return false;
+    }
+    // 编辑器保存时只在日志中写入保存标记，基础文件加上已保存的记录才是完整的文档
+    Journal::replay(job.input, doc, Journal::Replay::SavedOnly);
+
+    bool ok = false;
+    if (isDocumentOutput(job.output)) {
+        ok = doc.saveToFile(job.output, saveOptions);   // JSON / 二进制 / 压缩格式互相转换
+    } else {
+        ok = isSvgOutput(job.output) ? doc.exportToSvg(job.output, options)
+                                     : doc.exportToPng(job.output, options);
+    }
+    if (!ok) {
+        error = QString("cannot write %1").arg(job.output);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // 默认使用 offscreen 平台插件，保证在没有显示器的构建机上也能运行
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("flowdraw-cli");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // FLOWDRAW_TRACE=<文件名> 时记录性能跟踪，退出时关闭文件
+    Tracer::startFromEnvironment();
+    struct TraceGuard { ~TraceGuard() { Tracer::stop(); } } traceGuard;
+
+    /* ---------- 命令行参数 ---------- */
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render FlowDraw diagrams to PNG or SVG without a display.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Diagram file to render (.json/.flow/.fdb/.fdz).", "[input]");
+
+    QCommandLineOption outputOpt(QStringList() << "o" << "output",
+        "Output file; the format follows the suffix (.png, .svg, or .json/.flow/.fdb/.fdz to convert).", "file");
+    QCommandLineOption formatOpt(QStringList() << "f" << "format",
+        "Output format when no output file is given: png, svg, json, flow, fdb or fdz.", "format", "png");
+    QCommandLineOption zoomOpt(QStringList() << "z" << "zoom",
+        "Zoom factor applied to the diagram.", "factor", "1");
+    QCommandLineOption regionOpt(QStringList() << "r" << "region",
+        "Document region to render, as x,y,w,h (defaults to the whole page, or the content bounds on an unbounded canvas).", "rect");
+    QCommandLineOption dpiOpt(QStringList() << "d" << "dpi",
+        "Output resolution; PNG pixel size scales with dpi/96.", "dpi", "96");
+    QCommandLineOption ratioOpt("pixel-ratio",
+        "Device pixel ratio for PNG output, e.g. 2 for HiDPI screens; multiplies the pixel size and the recorded dpi.", "ratio", "1");
+    QCommandLineOption noGridOpt("no-grid", "Do not draw the page grid.");
+    QCommandLineOption batchOpt(QStringList() << "b" << "batch",
+        "Convert every .json/.flow/.fdb/.fdz diagram in a directory.", "dir");
+    QCommandLineOption outDirOpt("out-dir",
+        "Output directory for batch mode (defaults to the input directory).", "dir");
+    QCommandLineOption levelOpt(QStringList() << "l" << "level",
+        "Compression level for .fdz output, 0 (none) to 9 (smallest), or -1 for the zlib default.", "level", "6");
+    QCommandLineOption jobsOpt(QStringList() << "j" << "jobs",
+        "Number of parallel workers in batch mode (defaults to all cores).", "n");
+
+    parser.addOption(outputOpt);
+    parser.addOption(formatOpt);
+    parser.addOption(zoomOpt);
+    parser.addOption(regionOpt);
+    parser.addOption(dpiOpt);
+    parser.addOption(ratioOpt);
+    parser.addOption(noGridOpt);
+    parser.addOption(batchOpt);
+    parser.addOption(outDirOpt);
+    parser.addOption(levelOpt);
+    parser.addOption(jobsOpt);
+    parser.process(app);
+
+    RenderOptions options;
+    bool ok = false;
+    options.zoom = parser.value(zoomOpt).toDouble(&ok);
+    if (!ok || options.zoom <= 0) {
+        err << "invalid zoom: " << parser.value(zoomOpt) << "\n";
+        return 2;
+    }
+    options.dpi = parser.value(dpiOpt).toInt(&ok);
+    if (!ok || options.dpi <= 0) {
+        err << "invalid dpi: " << parser.value(dpiOpt) << "\n";
+        return 2;
+    }
+    options.pixelRatio = parser.value(ratioOpt).toDouble(&ok);
+    if (!ok || options.pixelRatio <= 0) {
+        err << "invalid pixel ratio: " << parser.value(ratioOpt) << "\n";
+        return 2;
+    }
+    if (parser.isSet(regionOpt) && !parseRegion(parser.value(regionOpt), options.region)) {
+        err << "invalid region: " << parser.value(regionOpt) << "\n";
+        return 2;
+    }
+    options.drawGrid = !parser.isSet(noGridOpt);
+
+    SaveOptions saveOptions;
+    saveOptions.compressionLevel = parser.value(levelOpt).toInt(&ok);
+    if (!ok || saveOptions.compressionLevel < -1 || saveOptions.compressionLevel > 9) {
+        err << "invalid compression level: " << parser.value(levelOpt) << "\n";
+        return 2;
+    }
+
+    const QString format = parser.value(formatOpt).toLower();
+    if (format != "png" && format != "svg" && !isDocumentOutput("x." + format)) {
+        err << "unsupported format: " << format << "\n";
+        return 2;
+    }
+
+    /* ---------- 单文件模式 ---------- */
+    if (!parser.isSet(batchOpt)) {
+        const QStringList args = parser.positionalArguments();
+        if (args.size() != 1) {
+            parser.showHelp(2);
+        }
+
+        ConvertJob job;
+        job.input = args.first();
+        job.output = parser.value(outputOpt);
+        if (job.output.isEmpty()) {
+            QFileInfo info(job.input);
+            job.output = info.dir().filePath(info.completeBaseName() + "." + format);
+        }
+
+        QString error;
+        if (!convert(job, options, saveOptions, error)) {
+            err << error << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    /* ---------- 批量模式：整个目录并行转换 ---------- */
+    QDir inDir(parser.value(batchOpt));
+    if (!inDir.exists()) {
+        err << "no such directory: " << inDir.path() << "\n";
+        return 2;
+    }
+    QDir outDir(parser.isSet(outDirOpt) ? parser.value(outDirOpt) : inDir.path());
+    if (!outDir.exists() && !QDir().mkpath(outDir.path())) {
+        err << "cannot create directory: " << outDir.path() << "\n";
+        return 1;
+    }
+
+    std::vector<ConvertJob> jobs;
+    const QFileInfoList files = inDir.entryInfoList(
+        QStringList() << "*.json" << "*.flow" << "*.fdb" << "*.fdz", QDir::Files, QDir::Name);
+    for (const QFileInfo& info : files) {
+        const QString output = outDir.filePath(info.completeBaseName() + "." + format);
+        if (QFileInfo(output) == info) continue;   // 格式相同时不覆盖源文件
+        jobs.push_back({ info.filePath(), output });
+    }
+
+    int workerCount = QThread::idealThreadCount();
+    if (parser.isSet(jobsOpt)) {
+        workerCount = parser.value(jobsOpt).toInt(&ok);
+        if (!ok || workerCount <= 0) {
+            err << "invalid job count: " << parser.value(jobsOpt) << "\n";
+            return 2;
+        }
+    }
+    workerCount = qBound(1, workerCount, qMax(1, static_cast<int>(jobs.size())));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 各工作线程从共享下标中领取任务，每个任务使用独立的 Document
+    std::atomic<size_t> next(0);
+    std::atomic<int> failed(0);
+    std::mutex logMutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            QString error;
+            if (!convert(jobs[i], options, saveOptions, error)) {
+                ++failed;
+                std::lock_guard<std::mutex> lock(logMutex);
+                err << error << "\n";
+                err.flush();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workerCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    out << "converted " << (static_cast<int>(jobs.size()) - failed.load()) << "/" << jobs.size()
+        << " diagrams with " << workerCount << " workers in " << timer.elapsed() << " ms\n";
+    return failed.load() == 0 ? 0 : 1;
+}
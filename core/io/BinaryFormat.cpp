@@ -0,0 +1,344 @@
+#include "BinaryFormat.hpp"
+#include "model/Document.hpp"
+#include "model/ShapeFactory.hpp"
+#include "model/RoundedRect.hpp"
+#include "LoadSink.hpp"
+
+#include <QHash>
+#include <QIODevice>
+#include <cstring>
+#include <vector>
+
+namespace binfmt {
+
+namespace {
+
+// 图形类型表：下标即 ShapeRecord::type，只能在末尾追加
+const char* const TypeNames[] = {
+    "rect", "ellipse", "diamond", "triangle", "pentagon",
+    "hexagon", "octagon", "roundedrect", "capsule", "recttriangle"
+};
+constexpr int TypeCount = sizeof(TypeNames) / sizeof(TypeNames[0]);
+
+int typeIndex(const char* name)
+{
+    for (int i = 0; i < TypeCount; ++i) {
+        if (std::strcmp(TypeNames[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+quint64 align8(quint64 n) { return (n + 7) & ~quint64(7); }
+
+// 颜色调色板：相同的 ARGB 值只存一份
+class Palette
+{
+public:
+    quint32 intern(const QColor& c)
+    {
+        const QRgb rgba = c.rgba();
+        auto it = index_.constFind(rgba);
+        if (it != index_.constEnd()) return it.value();
+        quint32 i = static_cast<quint32>(colors_.size());
+        colors_.push_back(rgba);
+        index_.insert(rgba, i);
+        return i;
+    }
+    const std::vector<quint32>& colors() const { return colors_; }
+
+private:
+    std::vector<quint32>   colors_;
+    QHash<QRgb, quint32>   index_;
+};
+
+// 写入数据并补齐到 8 字节边界
+bool writeAligned(QIODevice& out, const void* data, qint64 bytes)
+{
+    if (bytes > 0 && out.write(static_cast<const char*>(data), bytes) != bytes) return false;
+    static const char zeros[8] = {};
+    qint64 pad = static_cast<qint64>(align8(bytes)) - bytes;
+    return pad == 0 || out.write(zeros, pad) == pad;
+}
+
+// 检查 [offset, offset + bytes) 是否落在文件内
+bool inRange(quint64 offset, quint64 bytes, qint64 size)
+{
+    return offset <= static_cast<quint64>(size) && bytes <= static_cast<quint64>(size) - offset;
+}
+
+} // namespace
+
+bool isBinaryDocument(const QByteArray& head)
+{
+    return head.size() >= 4 && std::memcmp(head.constData(), Magic, 4) == 0;
+}
+
+bool writeBinaryDocument(const Document& doc, QIODevice& out)
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    Q_UNUSED(doc); Q_UNUSED(out);
+    return false;   // 记录按主机字节序原样写出，只支持小端平台
+#else
+    Palette palette;
+    std::u16string strings;
+    std::vector<ShapeRecord> shapeRecords(doc.shapes.size());
+    std::vector<ConnectorRecord> connRecords;
+    connRecords.reserve(doc.connectors.size());
+
+    // 图形指针 → 下标，连接线两端据此转换
+    QHash<const Shape*, quint32> shapeIndex;
+    shapeIndex.reserve(static_cast<int>(doc.shapes.size()));
+
+    size_t i = 0;
+    for (auto it = doc.shapes.begin(); it != doc.shapes.end(); ++it, ++i) {
+        const Shape* s = *it;
+        ShapeRecord& r = shapeRecords[i];
+        std::memset(&r, 0, sizeof(r));
+
+        int type = typeIndex(s->typeName());
+        if (type < 0) return false;
+        r.type = static_cast<quint16>(type);
+        r.x = s->bounds.x();
+        r.y = s->bounds.y();
+        r.w = s->bounds.width();
+        r.h = s->bounds.height();
+        r.strokeWidth = s->strokeWidth();
+        if (auto rr = dynamic_cast<const RoundedRect*>(s)) r.extra = rr->cornerRadius();
+        r.fillColor = palette.intern(s->fillColor());
+        r.strokeColor = palette.intern(s->strokeColor());
+        r.textColor = palette.intern(s->textColor());
+        r.textSize = s->textSize();
+        r.textOffset = static_cast<quint32>(strings.size());
+        r.textLength = static_cast<quint32>(s->text.size());
+        strings.append(reinterpret_cast<const char16_t*>(s->text.utf16()), s->text.size());
+
+        shapeIndex.insert(s, static_cast<quint32>(i));
+    }
+
+    for (const Connector& c : doc.connectors) {
+        auto src = shapeIndex.constFind(c.src);
+        auto dst = shapeIndex.constFind(c.dst);
+        if (src == shapeIndex.constEnd() || dst == shapeIndex.constEnd()) continue;   // 与 JSON 一致，跳过悬空连接线
+
+        ConnectorRecord r;
+        r.src = src.value();
+        r.dst = dst.value();
+        r.color = palette.intern(c.color);
+        r.flags = c.bidirectional ? 1u : 0u;
+        r.width = c.width;
+        connRecords.push_back(r);
+    }
+
+    BinaryHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, Magic, 4);
+    h.version = Version;
+    h.headerSize = sizeof(BinaryHeader);
+    h.backgroundColor = palette.intern(doc.backgroundColor);
+    h.shapeCount = static_cast<quint32>(shapeRecords.size());
+    h.connectorCount = static_cast<quint32>(connRecords.size());
+    h.paletteCount = static_cast<quint32>(palette.colors().size());
+    h.stringUnits = static_cast<quint32>(strings.size());
+    h.pageWidth = static_cast<quint32>(qMax(0, doc.pageSize.width()));
+    h.pageHeight = static_cast<quint32>(qMax(0, doc.pageSize.height()));
+    h.flags = doc.showGrid ? 1u : 0u;
+
+    h.paletteOffset = align8(sizeof(BinaryHeader));
+    h.shapesOffset = h.paletteOffset + align8(quint64(h.paletteCount) * sizeof(quint32));
+    h.connectorsOffset = h.shapesOffset + quint64(h.shapeCount) * sizeof(ShapeRecord);
+    h.stringsOffset = h.connectorsOffset + quint64(h.connectorCount) * sizeof(ConnectorRecord);
+
+    return writeAligned(out, &h, sizeof(h))
+        && writeAligned(out, palette.colors().data(), qint64(h.paletteCount) * sizeof(quint32))
+        && writeAligned(out, shapeRecords.data(), qint64(h.shapeCount) * sizeof(ShapeRecord))
+        && writeAligned(out, connRecords.data(), qint64(h.connectorCount) * sizeof(ConnectorRecord))
+        && writeAligned(out, strings.data(), qint64(h.stringUnits) * sizeof(char16_t));
+#endif
+}
+
+namespace {
+
+// 映射后的文档：校验过的头部和各段指针
+struct MappedDocument {
+    BinaryHeader           header;
+    const quint32*         palette = nullptr;
+    const ShapeRecord*     shapes = nullptr;
+    const ConnectorRecord* connectors = nullptr;
+    const QChar*           strings = nullptr;
+
+    QColor color(quint32 index) const { return QColor::fromRgba(palette[index]); }
+};
+
+// 校验头部和各段位置，防止损坏的文件越界读取
+bool mapDocument(const uchar* data, qint64 size, MappedDocument& m)
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    Q_UNUSED(data); Q_UNUSED(size); Q_UNUSED(m);
+    return false;   // 记录按主机字节序原样读取，只支持小端平台
+#else
+    if (!data || size < static_cast<qint64>(sizeof(BinaryHeader))) return false;
+
+    BinaryHeader& h = m.header;
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, Magic, 4) != 0) return false;
+    if (h.version > Version || h.headerSize < sizeof(BinaryHeader)) return false;
+
+    if (!inRange(h.paletteOffset, quint64(h.paletteCount) * sizeof(quint32), size) ||
+        !inRange(h.shapesOffset, quint64(h.shapeCount) * sizeof(ShapeRecord), size) ||
+        !inRange(h.connectorsOffset, quint64(h.connectorCount) * sizeof(ConnectorRecord), size) ||
+        !inRange(h.stringsOffset, quint64(h.stringUnits) * sizeof(char16_t), size) ||
+        h.stringsOffset % alignof(char16_t) != 0) {
+        return false;
+    }
+    if (h.backgroundColor >= h.paletteCount) return false;
+
+    m.palette = reinterpret_cast<const quint32*>(data + h.paletteOffset);
+    m.shapes = reinterpret_cast<const ShapeRecord*>(data + h.shapesOffset);
+    m.connectors = reinterpret_cast<const ConnectorRecord*>(data + h.connectorsOffset);
+    m.strings = reinterpret_cast<const QChar*>(data + h.stringsOffset);
+    return true;
+#endif
+}
+
+bool validShapeRecord(const MappedDocument& m, const ShapeRecord& r)
+{
+    const BinaryHeader& h = m.header;
+    return r.type < TypeCount &&
+           r.fillColor < h.paletteCount && r.strokeColor < h.paletteCount &&
+           r.textColor < h.paletteCount &&
+           quint64(r.textOffset) + r.textLength <= h.stringUnits;
+}
+
+bool validConnectorRecord(const MappedDocument& m, const ConnectorRecord& r)
+{
+    const BinaryHeader& h = m.header;
+    return r.src < h.shapeCount && r.dst < h.shapeCount && r.color < h.paletteCount;
+}
+
+// 由已校验的记录构建图形
+std::unique_ptr<Shape> makeShape(const MappedDocument& m, const ShapeRecord& r)
+{
+    static const QString typeNames[TypeCount] = {
+        TypeNames[0], TypeNames[1], TypeNames[2], TypeNames[3], TypeNames[4],
+        TypeNames[5], TypeNames[6], TypeNames[7], TypeNames[8], TypeNames[9]
+    };
+
+    auto shape = createShape(typeNames[r.type]);
+    shape->bounds = QRectF(r.x, r.y, r.w, r.h);
+    Style style;
+    style.fillColor = m.color(r.fillColor);
+    style.strokeColor = m.color(r.strokeColor);
+    style.strokeWidth = r.strokeWidth;
+    style.textColor = m.color(r.textColor);
+    style.textSize = r.textSize;
+    shape->style = Style::intern(style);
+    if (r.textLength > 0) shape->text = QString(m.strings + r.textOffset, static_cast<int>(r.textLength));
+    if (auto rr = dynamic_cast<RoundedRect*>(shape.get())) rr->setCornerRadius(r.extra);
+    return shape;
+}
+
+} // namespace
+
+bool readBinaryDocument(const uchar* data, qint64 size, Document& doc)
+{
+    MappedDocument m;
+    if (!mapDocument(data, size, m)) return false;
+    const BinaryHeader& h = m.header;
+
+    // 先构建到临时容器，全部成功后再替换文档内容
+    std::vector<std::unique_ptr<Shape>> shapes;
+    shapes.reserve(h.shapeCount);
+    for (quint32 i = 0; i < h.shapeCount; ++i) {
+        if (!validShapeRecord(m, m.shapes[i])) return false;
+        shapes.push_back(makeShape(m, m.shapes[i]));
+    }
+
+    QVector<Connector> connectors;
+    connectors.reserve(h.connectorCount);
+    for (quint32 i = 0; i < h.connectorCount; ++i) {
+        const ConnectorRecord& r = m.connectors[i];
+        if (!validConnectorRecord(m, r)) return false;
+
+        Connector c;
+        c.src = shapes[r.src].get();
+        c.dst = shapes[r.dst].get();
+        c.color = m.color(r.color);
+        c.width = r.width;
+        c.bidirectional = (r.flags & 1u) != 0;
+        connectors.push_back(c);
+    }
+
+    doc.clear();
+    doc.shapes = std::move(shapes);
+    doc.connectors = std::move(connectors);
+    doc.backgroundColor = m.color(h.backgroundColor);
+    doc.pageSize = QSize(static_cast<int>(h.pageWidth), static_cast<int>(h.pageHeight));
+    doc.showGrid = (h.flags & 1u) != 0;
+    return true;
+}
+
+bool readBinaryProgressive(const uchar* data, qint64 size, LoadSink& sink, const QRectF& priority)
+{
+    MappedDocument m;
+    if (!mapDocument(data, size, m)) return false;
+    const BinaryHeader& h = m.header;
+
+    // 先整体校验，交付开始后不会再因为坏数据中途失败
+    for (quint32 i = 0; i < h.shapeCount; ++i) {
+        if (!validShapeRecord(m, m.shapes[i])) return false;
+    }
+    for (quint32 i = 0; i < h.connectorCount; ++i) {
+        if (!validConnectorRecord(m, m.connectors[i])) return false;
+    }
+
+    sink.page(m.color(h.backgroundColor),
+              QSize(static_cast<int>(h.pageWidth), static_cast<int>(h.pageHeight)),
+              (h.flags & 1u) != 0);
+
+    // 记录里直接带有外框，不必构建图形就能判断是否可见：
+    // 第一轮交付与 priority 相交的图形，第二轮交付其余图形
+    const int BatchSize = 2048;
+    std::vector<char> delivered(h.shapeCount, 0);
+    qint64 done = 0;
+    std::vector<LoadedShape> batch;
+    auto flush = [&]() {
+        if (batch.empty()) return;
+        done += static_cast<qint64>(batch.size());
+        sink.shapes(std::move(batch));
+        sink.progress(done, h.shapeCount);
+        batch.clear();
+    };
+
+    for (int pass = priority.isEmpty() ? 1 : 0; pass < 2; ++pass) {
+        for (quint32 i = 0; i < h.shapeCount; ++i) {
+            if (delivered[i]) continue;
+            const ShapeRecord& r = m.shapes[i];
+            if (pass == 0 && !QRectF(r.x, r.y, r.w, r.h).normalized().intersects(priority)) continue;
+
+            batch.push_back({ static_cast<int>(i), makeShape(m, r) });
+            delivered[i] = 1;
+            if (static_cast<int>(batch.size()) == BatchSize) {
+                flush();
+                if (sink.cancelled()) return false;
+            }
+        }
+        flush();   // 可见部分单独成批，尽早显示
+    }
+
+    std::vector<ConnectorSpec> connectors;
+    connectors.reserve(h.connectorCount);
+    for (quint32 i = 0; i < h.connectorCount; ++i) {
+        const ConnectorRecord& r = m.connectors[i];
+        ConnectorSpec spec;
+        spec.src = static_cast<int>(r.src);
+        spec.dst = static_cast<int>(r.dst);
+        spec.color = m.color(r.color);
+        spec.width = r.width;
+        spec.bidirectional = (r.flags & 1u) != 0;
+        connectors.push_back(spec);
+    }
+    sink.connectors(std::move(connectors));
+    return true;
+}
+
+} // namespace binfmt
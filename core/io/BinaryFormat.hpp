@@ -0,0 +1,84 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+class Document;
+class LoadSink;
+class QIODevice;
+class QRectF;
+
+/* FlowDraw 二进制文档格式（.fdb）
+
+   与 JSON 格式保存相同的内容，但面向快速加载设计：
+   - 所有图形、连接线都是定长记录，加载时直接按偏移读取，无需解析
+   - 颜色统一放入调色板（QRgb 数组），记录中只存下标
+   - 文本集中放入字符串表（UTF-16），记录中只存偏移和长度
+   - 文件通过 QFile::map 映射到内存后原地读取
+
+   文件布局（小端序，各段按 8 字节对齐）：
+       BinaryHeader | 调色板 quint32[paletteCount] | ShapeRecord[shapeCount]
+       | ConnectorRecord[connectorCount] | 字符串表 char16_t[stringUnits]   */
+namespace binfmt {
+
+constexpr char    Magic[4] = { 'F', 'D', 'B', '1' };
+constexpr quint16 Version  = 1;
+
+#pragma pack(push, 1)
+struct BinaryHeader {
+    char    magic[4];
+    quint16 version;
+    quint16 headerSize;        // sizeof(BinaryHeader)，便于以后扩展
+    quint32 shapeCount;
+    quint32 connectorCount;
+    quint32 paletteCount;
+    quint32 stringUnits;       // 字符串表长度（UTF-16 码元数）
+    quint32 backgroundColor;   // 调色板下标
+    quint32 pageWidth;
+    quint32 pageHeight;
+    quint32 flags;             // 位 0：显示网格
+    quint64 paletteOffset;
+    quint64 shapesOffset;
+    quint64 connectorsOffset;
+    quint64 stringsOffset;
+};
+
+struct ShapeRecord {
+    double  x, y, w, h;
+    double  strokeWidth;
+    double  extra;             // 类型相关参数：圆角矩形为圆角半径
+    quint32 fillColor;         // 以下三项为调色板下标
+    quint32 strokeColor;
+    quint32 textColor;
+    quint32 textOffset;        // 字符串表中的偏移（码元）
+    quint32 textLength;        // 文本长度（码元）
+    quint16 type;              // 图形类型，见 BinaryFormat.cpp 中的类型表
+    quint16 reserved;
+    qint32  textSize;
+    quint32 padding;
+};
+
+struct ConnectorRecord {
+    quint32 src;               // 起点图形下标
+    quint32 dst;               // 终点图形下标
+    quint32 color;             // 调色板下标
+    quint32 flags;             // 位 0：双向箭头
+    double  width;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BinaryHeader) == 72, "BinaryHeader layout changed");
+static_assert(sizeof(ShapeRecord) == 80, "ShapeRecord layout changed");
+static_assert(sizeof(ConnectorRecord) == 24, "ConnectorRecord layout changed");
+
+// 数据开头是否为二进制文档的魔数
+bool isBinaryDocument(const QByteArray& head);
+
+// 将文档写入设备
+bool writeBinaryDocument(const Document& doc, QIODevice& out);
+// 从内存（通常是 QFile::map 的结果）读取文档；数据不合法时返回 false，doc 保持不变
+bool readBinaryDocument(const uchar* data, qint64 size, Document& doc);
+// 渐进读取：先交付外框与 priority 相交的图形，再交付其余图形（见 LoadSink）
+bool readBinaryProgressive(const uchar* data, qint64 size, LoadSink& sink, const QRectF& priority);
+
+} // namespace binfmt
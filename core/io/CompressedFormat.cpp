@@ -0,0 +1,163 @@
+#include "CompressedFormat.hpp"
+#include "JsonStream.hpp"
+
+#include <QBuffer>
+#include <QFile>
+#include <QThread>
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace zfmt {
+
+namespace {
+
+constexpr int MinChunkSize = 4 * 1024;
+constexpr int MaxChunkSize = 64 * 1024 * 1024;
+
+// 在最多 idealThreadCount 个线程上执行 task(0) ~ task(count - 1)，调用线程也参与
+template <typename Task>
+void parallelFor(int count, Task task)
+{
+    const int threadCount = qMin(qMax(1, QThread::idealThreadCount()), qMax(1, count));
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) task(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; ++i) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+}
+
+// 检查 [offset, offset + bytes) 是否落在数据内
+bool inRange(quint64 offset, quint64 bytes, qint64 size)
+{
+    return offset <= static_cast<quint64>(size) && bytes <= static_cast<quint64>(size) - offset;
+}
+
+} // namespace
+
+bool isCompressedDocument(const QByteArray& head)
+{
+    return head.size() >= 4 && std::memcmp(head.constData(), Magic, 4) == 0;
+}
+
+bool writeCompressedDocument(const Document& doc, QIODevice& out, int level, int chunkSize)
+{
+    // 先得到与 .flow 相同的紧凑 JSON 文本
+    QByteArray json;
+    {
+        QBuffer buffer(&json);
+        buffer.open(QIODevice::WriteOnly);
+        if (!writeJsonDocument(doc, buffer)) return false;
+    }
+
+    level = qBound(-1, level, 9);
+    chunkSize = qBound(MinChunkSize, chunkSize, MaxChunkSize);
+    const int count = (json.size() + chunkSize - 1) / chunkSize;
+
+    // 各块独立压缩，互不依赖
+    std::vector<QByteArray> chunks(count);
+    const uchar* raw = reinterpret_cast<const uchar*>(json.constData());
+    parallelFor(count, [&](int i) {
+        const int offset = i * chunkSize;
+        chunks[i] = qCompress(raw + offset, qMin(chunkSize, json.size() - offset), level);
+    });
+
+    CompressedHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, Magic, 4);
+    h.version = qToLittleEndian(Version);
+    h.headerSize = qToLittleEndian<quint16>(sizeof(CompressedHeader));
+    h.chunkCount = qToLittleEndian<quint32>(count);
+    h.level = qToLittleEndian<qint32>(level);
+    h.rawSize = qToLittleEndian<quint64>(json.size());
+
+    std::vector<ChunkEntry> table(count);
+    for (int i = 0; i < count; ++i) {
+        if (chunks[i].isEmpty()) return false;   // qCompress 失败（内存不足）
+        table[i].compressedSize = qToLittleEndian<quint32>(chunks[i].size());
+        table[i].rawSize = qToLittleEndian<quint32>(qMin(chunkSize, json.size() - i * chunkSize));
+    }
+
+    const qint64 tableBytes = qint64(count) * sizeof(ChunkEntry);
+    if (out.write(reinterpret_cast<const char*>(&h), sizeof(h)) != qint64(sizeof(h))) return false;
+    if (tableBytes > 0 && out.write(reinterpret_cast<const char*>(table.data()), tableBytes) != tableBytes) {
+        return false;
+    }
+    for (const QByteArray& chunk : chunks) {
+        if (out.write(chunk) != chunk.size()) return false;
+    }
+    return true;
+}
+
+bool decompressDocument(const uchar* data, qint64 size, QByteArray& json)
+{
+    if (!data || size < static_cast<qint64>(sizeof(CompressedHeader))) return false;
+
+    CompressedHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, Magic, 4) != 0) return false;
+    const quint16 version = qFromLittleEndian(h.version);
+    const quint16 headerSize = qFromLittleEndian(h.headerSize);
+    const quint32 count = qFromLittleEndian(h.chunkCount);
+    const quint64 rawSize = qFromLittleEndian(h.rawSize);
+    if (version > Version || headerSize < sizeof(CompressedHeader)) return false;
+    if (rawSize > static_cast<quint64>(std::numeric_limits<int>::max())) return false;   // 超出 QByteArray 上限
+    if (!inRange(headerSize, quint64(count) * sizeof(ChunkEntry), size)) return false;
+
+    // 读取块表，算出每块在文件和输出中的位置，全部校验后再解压
+    std::vector<ChunkEntry> table(count);
+    std::vector<quint64> inOffset(count), outOffset(count);
+    quint64 pos = headerSize + quint64(count) * sizeof(ChunkEntry);
+    quint64 rawPos = 0;
+    for (quint32 i = 0; i < count; ++i) {
+        std::memcpy(&table[i], data + headerSize + quint64(i) * sizeof(ChunkEntry), sizeof(ChunkEntry));
+        table[i].compressedSize = qFromLittleEndian(table[i].compressedSize);
+        table[i].rawSize = qFromLittleEndian(table[i].rawSize);
+        if (table[i].compressedSize < 4 || table[i].rawSize > static_cast<quint32>(MaxChunkSize) ||
+            !inRange(pos, table[i].compressedSize, size)) {
+            return false;
+        }
+        inOffset[i] = pos;
+        outOffset[i] = rawPos;
+        pos += table[i].compressedSize;
+        rawPos += table[i].rawSize;
+    }
+    if (rawPos != rawSize) return false;
+
+    QByteArray result(static_cast<int>(rawSize), Qt::Uninitialized);
+    char* dst = result.data();   // 在启动工作线程之前完成 detach
+    std::atomic<bool> ok(true);
+    parallelFor(static_cast<int>(count), [&](int i) {
+        if (!ok) return;
+        const QByteArray chunk = qUncompress(data + inOffset[i], static_cast<int>(table[i].compressedSize));
+        if (chunk.size() != static_cast<int>(table[i].rawSize)) {
+            ok = false;
+            return;
+        }
+        std::memcpy(dst + outOffset[i], chunk.constData(), chunk.size());
+    });
+    if (!ok) return false;
+
+    json = std::move(result);
+    return true;
+}
+
+bool decompressFile(QFile& file, QByteArray& json)
+{
+    if (uchar* mapped = file.map(0, file.size())) {
+        bool ok = decompressDocument(mapped, file.size(), json);
+        file.unmap(mapped);
+        return ok;
+    }
+    const QByteArray data = file.readAll();   // 无法映射时（如某些网络文件系统）退回普通读取
+    return decompressDocument(reinterpret_cast<const uchar*>(data.constData()), data.size(), json);
+}
+
+} // namespace zfmt
@@ -0,0 +1,56 @@
+#pragma once
+#include <QByteArray>
+#include <QtGlobal>
+
+class Document;
+class QFile;
+class QIODevice;
+
+/* FlowDraw 压缩文档格式（.fdz）
+
+   内容就是 writeJsonDocument 写出的 JSON 文本，切成定长的块后分别用
+   qCompress（zlib）压缩。各块互不依赖，保存时并行压缩，加载时并行解压，
+   解压后的 JSON 再交给流式解析器，因此与 .flow 读到的内容完全相同。
+
+   文件布局（所有整数均为小端序）：
+       CompressedHeader | ChunkEntry[chunkCount] | 压缩块数据（依次排列）
+   每个压缩块都是 qCompress 的原样输出（4 字节大端原始长度 + zlib 数据流）。 */
+namespace zfmt {
+
+constexpr char    Magic[4] = { 'F', 'D', 'Z', '1' };
+constexpr quint16 Version  = 1;
+
+constexpr int DefaultLevel     = 6;          // zlib 压缩级别：0 不压缩 ~ 9 最高，-1 为 zlib 默认
+constexpr int DefaultChunkSize = 1 << 20;    // 每块原始字节数
+
+#pragma pack(push, 1)
+struct CompressedHeader {
+    char    magic[4];
+    quint16 version;
+    quint16 headerSize;        // sizeof(CompressedHeader)，便于以后扩展
+    quint32 chunkCount;
+    qint32  level;             // 保存时使用的压缩级别，仅供参考
+    quint64 rawSize;           // 解压后的 JSON 总字节数
+};
+
+struct ChunkEntry {
+    quint32 compressedSize;    // 文件中该块的字节数
+    quint32 rawSize;           // 该块解压后的字节数
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CompressedHeader) == 24, "CompressedHeader layout changed");
+static_assert(sizeof(ChunkEntry) == 8, "ChunkEntry layout changed");
+
+// 数据开头是否为压缩文档的魔数
+bool isCompressedDocument(const QByteArray& head);
+
+// 将文档压缩写入设备；level 为 zlib 压缩级别，chunkSize 为每块原始字节数
+bool writeCompressedDocument(const Document& doc, QIODevice& out,
+                             int level = DefaultLevel, int chunkSize = DefaultChunkSize);
+// 并行解压内存中的压缩文档，得到 JSON 文本；数据不合法时返回 false
+bool decompressDocument(const uchar* data, qint64 size, QByteArray& json);
+// 解压已打开的文件（优先映射到内存，无法映射时整体读入）
+bool decompressFile(QFile& file, QByteArray& json);
+
+} // namespace zfmt
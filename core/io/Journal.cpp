@@ -0,0 +1,360 @@
+#include "Journal.hpp"
+#include "model/Document.hpp"
+#include "model/ColorParse.hpp"
+#include "trace/Trace.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+namespace {
+
+constexpr int    FormatVersion     = 1;
+constexpr qint64 MinCompactBytes   = 1 << 20;   // 已保存记录少于 1MB 时不合并
+
+// 基础文件的标识：大小 + 修改时间（重命名不会改变这两项）
+QJsonObject fileIdentity(const QString& file)
+{
+    QFileInfo info(file);
+    QJsonObject id;
+    id["size"] = static_cast<double>(info.size());
+    id["modified"] = static_cast<double>(info.lastModified().toMSecsSinceEpoch());
+    return id;
+}
+
+QByteArray headerLine(const QString& baseFile)
+{
+    QJsonObject header = fileIdentity(baseFile);
+    header["journal"] = FormatVersion;
+    return QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool matchesBase(const QJsonObject& header, const QString& baseFile)
+{
+    if (header["journal"].toInt() != FormatVersion || !QFileInfo::exists(baseFile)) return false;
+    const QJsonObject id = fileIdentity(baseFile);
+    return header["size"] == id["size"] && header["modified"] == id["modified"];
+}
+
+// 合并时写出的临时文件：与基础文件同目录、同后缀（保存格式由后缀决定）
+QString compactPathFor(const QString& docFile)
+{
+    QFileInfo info(docFile);
+    return info.dir().filePath(".~" + info.fileName());
+}
+
+// 日志文件的内容：头部和完整的记录行；遇到写了一半或无法解析的行时停止
+struct JournalContents {
+    QJsonObject              header;
+    qint64                   headerBytes = 0;
+    std::vector<QJsonObject> records;
+    std::vector<qint64>      ends;       // 每条记录结束处的文件偏移
+    int                      saved = 0;  // 最后一个保存标记之前（含）的记录数
+};
+
+bool readJournal(const QString& path, JournalContents& contents)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QByteArray line = file.readLine();
+    if (!line.endsWith('\n')) return false;
+    contents.header = QJsonDocument::fromJson(line).object();
+    contents.headerBytes = file.pos();
+
+    while (!file.atEnd()) {
+        line = file.readLine();
+        if (!line.endsWith('\n')) break;   // 崩溃时写了一半的记录
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) break;
+
+        contents.records.push_back(doc.object());
+        contents.ends.push_back(file.pos());
+        if (contents.records.back()["op"].toString() == QLatin1String("save")) {
+            contents.saved = static_cast<int>(contents.records.size());
+        }
+    }
+    return true;
+}
+
+QJsonObject recordToJson(const ActionRecord& record, bool forward)
+{
+    QJsonObject o;
+    o["op"] = forward ? "do" : "undo";
+    o["t"] = static_cast<int>(record.type);
+    o["i"] = record.elementIndex;
+    if (record.srcIndex >= 0) o["s"] = record.srcIndex;
+    if (record.dstIndex >= 0) o["d"] = record.dstIndex;
+    if (!record.stateBefore.isEmpty()) o["b"] = record.stateBefore;
+    if (!record.stateAfter.isEmpty()) o["a"] = record.stateAfter;
+    return o;
+}
+
+ActionRecord recordFromJson(const QJsonObject& o)
+{
+    ActionRecord record;
+    record.type = static_cast<ActionType>(o["t"].toInt());
+    record.elementIndex = o["i"].toInt(-1);
+    record.srcIndex = o["s"].toInt(-1);
+    record.dstIndex = o["d"].toInt(-1);
+    record.stateBefore = o["b"].toObject();
+    record.stateAfter = o["a"].toObject();
+    return record;
+}
+
+// 把一条记录应用到文档
+void applyRecord(const QJsonObject& o, Document& doc)
+{
+    const QString op = o["op"].toString();
+    if (op == QLatin1String("do") || op == QLatin1String("undo")) {
+        doc.replayRecord(recordFromJson(o), op == QLatin1String("do"));
+    } else if (op == QLatin1String("page")) {
+        doc.backgroundColor = parseColor(o["bg"].toString());
+        doc.pageSize = QSize(o["w"].toInt(doc.pageSize.width()), o["h"].toInt(doc.pageSize.height()));
+        doc.showGrid = o["grid"].toBool(doc.showGrid);
+    }
+}
+
+} // namespace
+
+Journal::~Journal()
+{
+    close();
+}
+
+QString Journal::pathFor(const QString& docFile)
+{
+    return docFile + ".journal";
+}
+
+bool Journal::needsCompaction() const
+{
+    // 合并的代价与文档大小成正比，按基础文件大小的比例触发，平摊后仍与改动量成正比
+    return isOpen() && saved_ > 0 && savedEnd() - headerBytes_ >= qMax(MinCompactBytes, baseSize_ / 4);
+}
+
+bool Journal::start(const QString& docFile)
+{
+    close();
+
+    const QByteArray header = headerLine(docFile);
+    file_.setFileName(pathFor(docFile));
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate) || file_.write(header) != header.size()) {
+        file_.close();
+        return false;
+    }
+    file_.flush();
+
+    docFile_ = docFile;
+    headerBytes_ = header.size();
+    baseSize_ = QFileInfo(docFile).size();
+    ends_.clear();
+    saved_ = 0;
+    return true;
+}
+
+bool Journal::resume(const QString& docFile, bool keepUnsaved)
+{
+    close();
+
+    JournalContents contents;
+    if (!readJournal(pathFor(docFile), contents) || !matchesBase(contents.header, docFile)) {
+        return start(docFile);
+    }
+
+    file_.setFileName(pathFor(docFile));
+    if (!file_.open(QIODevice::ReadWrite)) return false;
+
+    docFile_ = docFile;
+    headerBytes_ = contents.headerBytes;
+    baseSize_ = QFileInfo(docFile).size();
+    ends_ = std::move(contents.ends);
+    saved_ = contents.saved;
+    if (!keepUnsaved) ends_.resize(saved_);
+
+    // 去掉不再需要的记录和末尾写了一半的行，之后从这里继续追加
+    const qint64 end = ends_.empty() ? headerBytes_ : ends_.back();
+    file_.resize(end);
+    file_.seek(end);
+    return true;
+}
+
+void Journal::close()
+{
+    if (!isOpen()) return;
+
+    // 未保存的编辑随文档一起关闭；只剩头部时不保留日志文件
+    file_.resize(savedEnd());
+    file_.close();
+    if (saved_ == 0) QFile::remove(file_.fileName());
+
+    docFile_.clear();
+    ends_.clear();
+    saved_ = 0;
+}
+
+bool Journal::writeLine(const QByteArray& line)
+{
+    if (!isOpen()) return false;
+    if (file_.write(line) != line.size()) return false;
+    file_.flush();   // 每条记录立即交给操作系统，进程崩溃时不会丢失
+    ends_.push_back(file_.pos());
+    return true;
+}
+
+void Journal::actionApplied(const ActionRecord& record, bool forward)
+{
+    writeLine(QJsonDocument(recordToJson(record, forward)).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void Journal::pageChanged(const QColor& backgroundColor, const QSize& pageSize, bool showGrid)
+{
+    QJsonObject o;
+    o["op"] = "page";
+    o["bg"] = backgroundColor.name(QColor::HexArgb);
+    o["w"] = pageSize.width();
+    o["h"] = pageSize.height();
+    o["grid"] = showGrid;
+    writeLine(QJsonDocument(o).toJson(QJsonDocument::Compact) + '\n');
+}
+
+bool Journal::commit()
+{
+    TraceSpan span("Journal::commit", "io");
+    span.arg("records", unsavedRecords());
+
+    if (!writeLine("{\"op\":\"save\"}\n")) return false;
+    saved_ = static_cast<int>(ends_.size());
+    return true;
+}
+
+bool Journal::compact(const QString& docFile, int records, QString& compactFile)
+{
+    TraceSpan span("Journal::compact", "io");
+    span.arg("records", records);
+
+    JournalContents contents;
+    if (!readJournal(pathFor(docFile), contents) || records > static_cast<int>(contents.records.size())) {
+        return false;
+    }
+
+    Document doc;
+    if (!doc.loadFromFile(docFile)) return false;
+    for (int i = 0; i < records; ++i) {
+        applyRecord(contents.records[i], doc);
+    }
+
+    compactFile = compactPathFor(docFile);
+    if (!doc.saveToFile(compactFile)) {
+        QFile::remove(compactFile);
+        return false;
+    }
+    return true;
+}
+
+bool Journal::compactSaved()
+{
+    if (!isOpen() || saved_ == 0) return true;
+    file_.flush();
+    QString compactFile;
+    if (!compact(docFile_, saved_, compactFile)) {
+        if (!compactFile.isEmpty()) QFile::remove(compactFile);
+        return false;
+    }
+    return finishCompaction(compactFile, saved_);
+}
+
+bool Journal::finishCompaction(const QString& compactFile, int records)
+{
+    if (!isOpen() || records <= 0 || records > saved_ || !QFileInfo::exists(compactFile)) {
+        QFile::remove(compactFile);
+        return false;
+    }
+
+    // 取出合并点之后的记录
+    const qint64 cut = ends_[records - 1];
+    QByteArray tail;
+    {
+        QFile in(file_.fileName());
+        if (!in.open(QIODevice::ReadOnly) || !in.seek(cut)) {
+            QFile::remove(compactFile);
+            return false;
+        }
+        tail = in.readAll();
+    }
+
+    // 先写出指向合并结果的新日志，再替换基础文件；
+    // 两步之间中断时由 recoverCompaction 在下次打开时完成替换
+    const QByteArray header = headerLine(compactFile);
+    const QString path = file_.fileName();
+    file_.close();
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly) || out.write(header) != header.size() ||
+        out.write(tail) != tail.size() || !out.commit()) {
+        QFile::remove(compactFile);
+        file_.open(QIODevice::ReadWrite);
+        file_.seek(file_.size());
+        return false;
+    }
+    QFile::remove(docFile_);
+    QFile::rename(compactFile, docFile_);
+
+    file_.open(QIODevice::ReadWrite);
+    file_.seek(file_.size());
+
+    const qint64 shift = header.size() - cut;
+    ends_.erase(ends_.begin(), ends_.begin() + records);
+    for (qint64& end : ends_) end += shift;
+    saved_ -= records;
+    headerBytes_ = header.size();
+    baseSize_ = QFileInfo(docFile_).size();
+    return true;
+}
+
+void Journal::recoverCompaction(const QString& docFile)
+{
+    const QString compactFile = compactPathFor(docFile);
+    if (!QFileInfo::exists(compactFile)) return;
+
+    JournalContents contents;
+    if (readJournal(pathFor(docFile), contents) && matchesBase(contents.header, compactFile)) {
+        QFile::remove(docFile);
+        QFile::rename(compactFile, docFile);
+    } else {
+        QFile::remove(compactFile);   // 合并没有完成，基础文件仍然有效
+    }
+}
+
+Journal::Status Journal::inspect(const QString& docFile)
+{
+    Status status;
+    JournalContents contents;
+    if (!readJournal(pathFor(docFile), contents) || !matchesBase(contents.header, docFile)) {
+        return status;
+    }
+    status.valid = true;
+    status.savedRecords = contents.saved;
+    status.unsavedRecords = static_cast<int>(contents.records.size()) - contents.saved;
+    return status;
+}
+
+int Journal::replay(const QString& docFile, Document& doc, Replay range)
+{
+    TraceSpan span("Journal::replay", "io");
+
+    JournalContents contents;
+    if (!readJournal(pathFor(docFile), contents) || !matchesBase(contents.header, docFile)) {
+        return -1;
+    }
+
+    const int count = range == Replay::All ? static_cast<int>(contents.records.size()) : contents.saved;
+    for (int i = 0; i < count; ++i) {
+        applyRecord(contents.records[i], doc);
+    }
+    span.arg("records", count);
+    return count;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <QByteArray>
+#include <QColor>
+#include <QFile>
+#include <QSize>
+#include <QString>
+#include <vector>
+
+#include "model/History.hpp"
+
+class Document;
+
+/* 文档旁边的追加式编辑日志（<文档名>.journal）
+
+   每次提交的编辑（与进入撤销栈的操作相同），以及撤销、重做和页面设置修改，
+   都以一行紧凑 JSON 的形式追加到日志末尾。保存（Ctrl+S）只需追加一个保存标记，
+   写入量与改动大小成正比，而不是与文档大小成正比。
+
+   基础文件 + 日志中最后一个保存标记之前的记录 = 已保存的文档；
+   保存标记之后的记录是尚未保存的编辑，程序崩溃后可以回放恢复。
+   已保存的记录累积到一定量后，由后台线程合并（compact）回基础文件，日志随之缩短；
+   保存后空闲一段时间、以及关闭文档时，不足该量的记录也会合并，基础文件单独使用时内容是最新的。
+
+   文件格式：第一行为头部，记录基础文件的大小和修改时间，用于识别日志是否属于当前基础文件；
+   之后每行一条记录。写了一半的最后一行（崩溃时）在读取时被忽略。 */
+class Journal : public EditObserver
+{
+public:
+    // 回放范围
+    enum class Replay {
+        SavedOnly,   // 只回放到最后一个保存标记（已保存的状态）
+        All          // 同时回放崩溃前未保存的编辑
+    };
+
+    // inspect 的结果
+    struct Status {
+        bool valid = false;        // 日志存在且属于当前基础文件
+        int  savedRecords = 0;     // 最后一个保存标记之前的记录数（含标记）
+        int  unsavedRecords = 0;   // 最后一个保存标记之后的记录数
+    };
+
+    Journal() = default;
+    ~Journal() override;
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // 文档对应的日志文件名
+    static QString pathFor(const QString& docFile);
+
+    // 基础文件刚被完整写出：丢弃旧日志，开始一个空日志
+    bool start(const QString& docFile);
+    // 继续追加已有的日志；keepUnsaved 为 false 时截掉最后一个保存标记之后的记录
+    bool resume(const QString& docFile, bool keepUnsaved);
+    // 关闭日志，未保存的记录被丢弃；没有任何记录时删除日志文件
+    void close();
+
+    bool isOpen() const { return file_.isOpen(); }
+    QString documentFile() const { return docFile_; }
+
+    // 追加一条编辑记录：forward 为 true 表示执行（提交或重做），false 表示撤销
+    void actionApplied(const ActionRecord& record, bool forward) override;
+    // 追加页面设置修改
+    void pageChanged(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) override;
+    // 写入保存标记，此前的所有记录成为已保存状态
+    bool commit();
+
+    int savedRecords() const { return saved_; }
+    int unsavedRecords() const { return static_cast<int>(ends_.size()) - saved_; }
+    // 已保存的记录是否多到值得合并回基础文件（超过基础文件大小的 1/4，且至少 1MB）
+    bool needsCompaction() const;
+
+    /* ---------- 合并 ---------- */
+    // 在工作线程中执行：加载基础文件并回放日志前 records 条记录，写出到临时文件 compactFile
+    static bool compact(const QString& docFile, int records, QString& compactFile);
+    // 在 GUI 线程中执行：用 compactFile 替换基础文件，日志只保留第 records 条之后的记录
+    bool finishCompaction(const QString& compactFile, int records);
+    // 在当前线程中把所有已保存的记录合并回基础文件（关闭文档时使用，没有已保存的记录时直接返回）
+    bool compactSaved();
+
+    /* ---------- 回放 ---------- */
+    // 打开文档之前调用：上次合并在替换基础文件前中断时完成替换，或清理残留的临时文件
+    static void recoverCompaction(const QString& docFile);
+    // 检查文档旁边的日志
+    static Status inspect(const QString& docFile);
+    // 把日志回放到刚从基础文件加载的 doc 上，返回回放的记录数；日志不存在或不属于该文件时返回 -1
+    static int replay(const QString& docFile, Document& doc, Replay range);
+
+private:
+    bool writeLine(const QByteArray& line);
+    qint64 savedEnd() const { return saved_ > 0 ? ends_[saved_ - 1] : headerBytes_; }
+
+    QFile               file_;
+    QString             docFile_;
+    qint64              headerBytes_ = 0;
+    qint64              baseSize_ = 0;
+    std::vector<qint64> ends_;           // 每条记录结束处的文件偏移
+    int                 saved_ = 0;      // 最后一个保存标记之前（含）的记录数
+};
@@ -0,0 +1,671 @@
+#include "JsonStream.hpp"
+#include "model/Document.hpp"
+#include "model/ShapeFactory.hpp"
+#include "model/ColorParse.hpp"
+#include "LoadSink.hpp"
+
+#include <QHash>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr qint64 ReadChunkSize = 64 * 1024;   // 每次从设备读取的字节数
+constexpr int    MaxDepth = 512;              // 最大嵌套层数，防止恶意文件耗尽栈
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* 图形数组的并行解析：
+   读取线程只负责切分出每个元素的原始字节，攒够一块后放入队列；
+   工作线程对整块调用 QJsonDocument::fromJson 并构建图形；
+   各块结果按块序号存放，由读取线程按顺序交付，保证与文件中的顺序一致。 */
+class ShapeChunkParser
+{
+public:
+    using Deliver = std::function<void(std::vector<std::unique_ptr<Shape>>&&)>;
+
+    static constexpr int ChunkElements = 1024;   // 每块包含的图形数
+
+    explicit ShapeChunkParser(Deliver deliver)
+        : deliver_(std::move(deliver)),
+          threadCount_(qMax(1, QThread::idealThreadCount()))
+    {
+    }
+
+    ~ShapeChunkParser()
+    {
+        failed_ = true;   // 提前退出（读取出错）时丢弃排队中的块
+        stopWorkers();
+    }
+
+    // 追加一个图形元素的原始 JSON
+    void add(const QByteArray& element)
+    {
+        current_.append(currentCount_ == 0 ? '[' : ',');
+        current_.append(element);
+        if (++currentCount_ == ChunkElements) {
+            submit();
+            deliverReady();
+        }
+    }
+
+    // 等待全部块解析完成并交付剩余图形；任一块格式错误时返回 false
+    bool finish()
+    {
+        if (threads_.empty()) {
+            // 图形不足一块时直接在当前线程解析，省去线程开销
+            if (currentCount_ > 0) {
+                current_.append(']');
+                std::vector<std::unique_ptr<Shape>> shapes;
+                if (!parseChunk(current_, shapes)) return false;
+                deliver_(std::move(shapes));
+            }
+            return true;
+        }
+
+        if (currentCount_ > 0) submit();
+        stopWorkers();
+        if (failed_) return false;
+        deliverReady();
+        return true;
+    }
+
+private:
+    void submit()
+    {
+        current_.append(']');
+        if (threads_.empty()) {
+            for (int i = 0; i < threadCount_; ++i) threads_.emplace_back(&ShapeChunkParser::workerLoop, this);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 限制排队的块数，读取速度快于解析时让读取线程等待，避免原始字节堆积
+        spaceAvailable_.wait(lock, [this] { return queue_.size() < static_cast<size_t>(2 * threadCount_); });
+        queue_.emplace_back(results_.size(), std::move(current_));
+        results_.emplace_back();
+        ready_.push_back(false);
+        lock.unlock();
+        workAvailable_.notify_one();
+
+        current_ = QByteArray();
+        currentCount_ = 0;
+    }
+
+    // 按块序号交付已完成的前缀，某块未完成时停下，保证顺序
+    void deliverReady()
+    {
+        for (;;) {
+            std::vector<std::unique_ptr<Shape>> shapes;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (failed_ || nextDeliver_ >= ready_.size() || !ready_[nextDeliver_]) return;
+                shapes = std::move(results_[nextDeliver_]);
+                ++nextDeliver_;
+            }
+            deliver_(std::move(shapes));
+        }
+    }
+
+    void workerLoop()
+    {
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workAvailable_.wait(lock, [this] { return closing_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            auto task = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            spaceAvailable_.notify_one();
+
+            std::vector<std::unique_ptr<Shape>> shapes;
+            if (failed_ || !parseChunk(task.second, shapes)) {
+                failed_ = true;
+                continue;
+            }
+            lock.lock();
+            results_[task.first] = std::move(shapes);
+            ready_[task.first] = true;
+        }
+    }
+
+    void stopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closing_ = true;
+        }
+        workAvailable_.notify_all();
+        for (auto& t : threads_) t.join();
+        threads_.clear();
+    }
+
+    // 解析一块图形："[{...},{...},...]"，非对象元素和未知类型与以前一样跳过
+    static bool parseChunk(const QByteArray& json, std::vector<std::unique_ptr<Shape>>& shapes)
+    {
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(json, &error);
+        if (error.error != QJsonParseError::NoError || !doc.isArray()) return false;
+
+        const QJsonArray array = doc.array();
+        shapes.reserve(shapes.size() + array.size());
+        for (const QJsonValue& val : array) {
+            if (!val.isObject()) continue;
+            auto shape = createShapeFromJson(val.toObject());
+            if (shape) shapes.push_back(std::move(shape));
+        }
+        return true;
+    }
+
+    Deliver          deliver_;
+    const int        threadCount_;
+    QByteArray       current_;            // 正在积攒的块
+    int              currentCount_ = 0;
+
+    std::mutex                                          mutex_;
+    std::condition_variable                             workAvailable_;
+    std::condition_variable                             spaceAvailable_;
+    std::deque<std::pair<size_t, QByteArray>>           queue_;     // (块序号, 块内容)
+    std::vector<std::vector<std::unique_ptr<Shape>>>    results_;   // 按块序号存放
+    std::vector<bool>                                   ready_;     // 各块是否已解析完成
+    size_t                                              nextDeliver_ = 0;
+    bool                                                closing_ = false;
+    std::atomic<bool>                                   failed_{false};
+    std::vector<std::thread>                            threads_;
+};
+
+} // namespace
+
+/* ---------- JsonStreamReader ---------- */
+
+JsonStreamReader::JsonStreamReader(QIODevice* device)
+    : device_(device)
+{
+}
+
+bool JsonStreamReader::fill()
+{
+    if (pos_ < buffer_.size()) return true;
+    buffer_ = device_->read(ReadChunkSize);
+    pos_ = 0;
+    return !buffer_.isEmpty();
+}
+
+bool JsonStreamReader::peekChar(char& c)
+{
+    for (;;) {
+        if (!fill()) return false;
+        c = buffer_.at(pos_);
+        if (!isSpace(c)) return true;
+        ++pos_;
+    }
+}
+
+bool JsonStreamReader::setError(const QString& message)
+{
+    if (error_.isEmpty()) error_ = message;
+    return false;
+}
+
+bool JsonStreamReader::expect(char c)
+{
+    char next;
+    if (!peekChar(next)) return setError("unexpected end of data");
+    if (next != c) return setError(QString("expected '%1'").arg(c));
+    ++pos_;
+    return true;
+}
+
+bool JsonStreamReader::beginObject()
+{
+    if (!expect('{')) return false;
+    first_.push_back(true);
+    return true;
+}
+
+bool JsonStreamReader::nextKey(QString& key)
+{
+    if (hasError() || first_.empty()) return false;
+
+    char c;
+    if (!peekChar(c)) return setError("unterminated object");
+    if (c == '}') {
+        ++pos_;
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back() && !expect(',')) return false;
+    first_.back() = false;
+    return readString(key) && expect(':');
+}
+
+bool JsonStreamReader::beginArray()
+{
+    if (!expect('[')) return false;
+    first_.push_back(true);
+    return true;
+}
+
+bool JsonStreamReader::nextElement()
+{
+    if (hasError() || first_.empty()) return false;
+
+    char c;
+    if (!peekChar(c)) return setError("unterminated array");
+    if (c == ']') {
+        ++pos_;
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back() && !expect(',')) return false;
+    first_.back() = false;
+    return true;
+}
+
+bool JsonStreamReader::readString(QString& s)
+{
+    if (!expect('"')) return false;
+
+    // 字符串内容按 UTF-8 累积（跨缓冲区的多字节字符也能正确拼接），结束时一次解码
+    QByteArray utf8;
+    ushort highSurrogate = 0;   // \u 转义的代理对：暂存高位，等待低位
+    auto flushSurrogate = [&]() {
+        if (highSurrogate) utf8.append(QString(QChar(highSurrogate)).toUtf8());
+        highSurrogate = 0;
+    };
+
+    for (;;) {
+        if (!fill()) return setError("unterminated string");
+
+        // 快速路径：整段复制不含转义的字节
+        const char* data = buffer_.constData();
+        int start = pos_;
+        while (pos_ < buffer_.size() && data[pos_] != '"' && data[pos_] != '\\') ++pos_;
+        if (pos_ > start) {
+            flushSurrogate();
+            utf8.append(data + start, pos_ - start);
+        }
+        if (pos_ >= buffer_.size()) continue;
+
+        char c = data[pos_++];
+        if (c == '"') break;
+
+        // 转义序列
+        if (!fill()) return setError("unterminated escape");
+        c = buffer_.at(pos_++);
+        if (c != 'u') flushSurrogate();
+        switch (c) {
+            case '"':  utf8.append('"');  break;
+            case '\\': utf8.append('\\'); break;
+            case '/':  utf8.append('/');  break;
+            case 'b':  utf8.append('\b'); break;
+            case 'f':  utf8.append('\f'); break;
+            case 'n':  utf8.append('\n'); break;
+            case 'r':  utf8.append('\r'); break;
+            case 't':  utf8.append('\t'); break;
+            case 'u': {
+                ushort unit = 0;
+                for (int i = 0; i < 4; ++i) {
+                    if (!fill()) return setError("unterminated escape");
+                    int h = hexValue(buffer_.at(pos_++));
+                    if (h < 0) return setError("invalid \\u escape");
+                    unit = static_cast<ushort>((unit << 4) | h);
+                }
+                if (QChar::isHighSurrogate(unit)) {
+                    flushSurrogate();
+                    highSurrogate = unit;
+                } else if (QChar::isLowSurrogate(unit) && highSurrogate) {
+                    const QChar pair[2] = { QChar(highSurrogate), QChar(unit) };
+                    utf8.append(QString(pair, 2).toUtf8());
+                    highSurrogate = 0;
+                } else {
+                    flushSurrogate();
+                    utf8.append(QString(QChar(unit)).toUtf8());
+                }
+                break;
+            }
+            default:
+                return setError("invalid escape");
+        }
+    }
+    flushSurrogate();
+
+    s = QString::fromUtf8(utf8);
+    return true;
+}
+
+bool JsonStreamReader::readRawValue(QByteArray& out)
+{
+    char c;
+    if (!peekChar(c)) return setError("unexpected end of data");
+
+    // 只跟踪字符串和括号层级，遇到同层的 ',' 或外层的 ']' / '}' 即为值的结尾
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+    for (;;) {
+        if (!fill()) return setError("unexpected end of data");
+
+        const char* data = buffer_.constData();
+        const int size = buffer_.size();
+        const int start = pos_;
+        while (pos_ < size) {
+            c = data[pos_];
+            if (inString) {
+                if (escape) escape = false;
+                else if (c == '\\') escape = true;
+                else if (c == '"') inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) break;              // 外层容器结束，不属于该值
+                if (--depth == 0) { ++pos_; break; }
+            } else if (c == ',' && depth == 0) {
+                break;
+            }
+            ++pos_;
+        }
+        out.append(data + start, pos_ - start);
+        if (pos_ < size) return true;
+    }
+}
+
+bool JsonStreamReader::nextIsArray()
+{
+    char c;
+    return peekChar(c) && c == '[';
+}
+
+bool JsonStreamReader::readNumber(double& d)
+{
+    QByteArray text;
+    for (;;) {
+        if (!fill()) break;
+        char c = buffer_.at(pos_);
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+            text.append(c);
+            ++pos_;
+        } else {
+            break;
+        }
+    }
+
+    bool ok = false;
+    d = text.toDouble(&ok);
+    return ok || setError("invalid number");
+}
+
+bool JsonStreamReader::readLiteral(const char* word)
+{
+    for (const char* p = word; *p; ++p) {
+        if (!fill() || buffer_.at(pos_) != *p) return setError(QString("expected '%1'").arg(word));
+        ++pos_;
+    }
+    return true;
+}
+
+bool JsonStreamReader::readValue(QJsonValue& value)
+{
+    return readValueAt(value, 0);
+}
+
+bool JsonStreamReader::readValueAt(QJsonValue& value, int depth)
+{
+    if (depth > MaxDepth) return setError("nesting too deep");
+
+    char c;
+    if (!peekChar(c)) return setError("unexpected end of data");
+
+    switch (c) {
+        case '{': {
+            QJsonObject obj;
+            if (!beginObject()) return false;
+            QString key;
+            while (nextKey(key)) {
+                QJsonValue v;
+                if (!readValueAt(v, depth + 1)) return false;
+                obj.insert(key, v);
+            }
+            if (hasError()) return false;
+            value = obj;
+            return true;
+        }
+        case '[': {
+            QJsonArray arr;
+            if (!beginArray()) return false;
+            while (nextElement()) {
+                QJsonValue v;
+                if (!readValueAt(v, depth + 1)) return false;
+                arr.append(v);
+            }
+            if (hasError()) return false;
+            value = arr;
+            return true;
+        }
+        case '"': {
+            QString s;
+            if (!readString(s)) return false;
+            value = s;
+            return true;
+        }
+        case 't':
+            value = true;
+            return readLiteral("true");
+        case 'f':
+            value = false;
+            return readLiteral("false");
+        case 'n':
+            value = QJsonValue();
+            return readLiteral("null");
+        default: {
+            double d = 0;
+            if (!readNumber(d)) return false;
+            value = d;
+            return true;
+        }
+    }
+}
+
+bool JsonStreamReader::skipValue()
+{
+    return skipValueAt(0);
+}
+
+bool JsonStreamReader::skipValueAt(int depth)
+{
+    if (depth > MaxDepth) return setError("nesting too deep");
+
+    char c;
+    if (!peekChar(c)) return setError("unexpected end of data");
+
+    switch (c) {
+        case '{': {
+            if (!beginObject()) return false;
+            QString key;
+            while (nextKey(key)) {
+                if (!skipValueAt(depth + 1)) return false;
+            }
+            return !hasError();
+        }
+        case '[': {
+            if (!beginArray()) return false;
+            while (nextElement()) {
+                if (!skipValueAt(depth + 1)) return false;
+            }
+            return !hasError();
+        }
+        case '"': {
+            QString s;
+            return readString(s);
+        }
+        case 't': return readLiteral("true");
+        case 'f': return readLiteral("false");
+        case 'n': return readLiteral("null");
+        default: {
+            double d;
+            return readNumber(d);
+        }
+    }
+}
+
+/* ---------- 文档读写 ---------- */
+
+bool readJsonProgressive(QIODevice& in, LoadSink& sink)
+{
+    JsonStreamReader reader(&in);
+    if (!reader.beginObject()) return false;
+
+    const qint64 totalBytes = in.size();
+    int shapeCount = 0;
+    // QJsonDocument 按键名排序写出，connectors 位于 shapes 之前，只能先暂存，图形读完后再交付
+    std::vector<QJsonObject> connObjs;
+
+    QString key;
+    while (reader.nextKey(key)) {
+        if (sink.cancelled()) return false;
+
+        if (key == "page") {
+            QJsonValue value;
+            if (!reader.readValue(value)) return false;
+            if (value.isObject()) {
+                QJsonObject pageObj = value.toObject();
+                sink.page(parseColor(pageObj["backgroundColor"].toString("#fdfdfd")),
+                          QSize(pageObj["width"].toInt(2000), pageObj["height"].toInt(2000)),
+                          pageObj["showGrid"].toBool(true));
+            }
+        } else if ((key == "shapes" || key == "connectors") && reader.nextIsArray()) {
+            if (!reader.beginArray()) return false;
+            if (key == "shapes") {
+                // 图形：只切分原始字节，解析和构建交给工作线程，按文档顺序分批交付
+                ShapeChunkParser parser([&](std::vector<std::unique_ptr<Shape>>&& shapes) {
+                    std::vector<LoadedShape> batch;
+                    batch.reserve(shapes.size());
+                    for (auto& shape : shapes) batch.push_back({ shapeCount++, std::move(shape) });
+                    sink.shapes(std::move(batch));
+                    sink.progress(in.pos(), totalBytes);
+                });
+                QByteArray element;
+                while (reader.nextElement()) {
+                    if (sink.cancelled()) return false;
+                    element.clear();
+                    if (!reader.readRawValue(element)) return false;
+                    parser.add(element);
+                }
+                if (reader.hasError() || !parser.finish()) return false;
+            } else {
+                // 连接线：逐个读取，暂存为小对象
+                while (reader.nextElement()) {
+                    QJsonValue value;
+                    if (!reader.readValue(value)) return false;
+                    if (value.isObject()) connObjs.push_back(value.toObject());
+                }
+                if (reader.hasError()) return false;
+            }
+        } else {
+            if (!reader.skipValue()) return false;   // 未知字段或类型不符的值直接跳过
+        }
+    }
+    if (reader.hasError()) return false;
+
+    // 连接线两端以图形索引表示，越界的丢弃
+    std::vector<ConnectorSpec> connectors;
+    connectors.reserve(connObjs.size());
+    for (const QJsonObject& connObj : connObjs) {
+        ConnectorSpec spec;
+        spec.src = connObj["src"].toInt(-1);
+        spec.dst = connObj["dst"].toInt(-1);
+        if (spec.src < 0 || spec.src >= shapeCount || spec.dst < 0 || spec.dst >= shapeCount) continue;
+        spec.color = parseColor(connObj["color"].toString("#ff000000"));
+        spec.width = connObj["width"].toDouble(1.0);
+        spec.bidirectional = connObj["bidirectional"].toBool(false);
+        connectors.push_back(spec);
+    }
+    sink.connectors(std::move(connectors));
+    sink.progress(totalBytes, totalBytes);
+    return true;
+}
+
+bool readJsonDocument(QIODevice& in, Document& doc)
+{
+    // 先收集到临时变量，全部成功后再替换文档内容
+    DocumentSink sink(doc);
+    if (!readJsonProgressive(in, sink)) return false;
+    sink.commit();
+    return true;
+}
+
+// 写入一个紧凑的 JSON 值
+static bool writeCompact(QIODevice& out, const QJsonObject& obj)
+{
+    const QByteArray bytes = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    return out.write(bytes) == bytes.size();
+}
+
+bool writeJsonDocument(const Document& doc, QIODevice& out)
+{
+    bool ok = true;
+    auto write = [&](const char* text) { ok = ok && out.write(text) >= 0; };
+
+    QJsonObject pageObj;
+    pageObj["backgroundColor"] = doc.backgroundColor.name(QColor::HexArgb);
+    pageObj["width"] = doc.pageSize.width();
+    pageObj["height"] = doc.pageSize.height();
+    pageObj["showGrid"] = doc.showGrid;
+
+    write("{\n    \"page\": ");
+    ok = ok && writeCompact(out, pageObj);
+
+    // 图形逐个序列化并写出，不构建整个数组
+    write(",\n    \"shapes\": [");
+    QHash<const Shape*, int> shapeIndex;
+    shapeIndex.reserve(static_cast<int>(doc.shapes.size()));
+    int i = 0;
+    for (auto it = doc.shapes.begin(); it != doc.shapes.end() && ok; ++it, ++i) {
+        write(i == 0 ? "\n        " : ",\n        ");
+        ok = ok && writeCompact(out, (*it)->toJson());
+        shapeIndex.insert(*it, i);
+    }
+    write(doc.shapes.empty() ? "]" : "\n    ]");
+
+    write(",\n    \"connectors\": [");
+    bool first = true;
+    for (const Connector& conn : doc.connectors) {
+        auto src = shapeIndex.constFind(conn.src);
+        auto dst = shapeIndex.constFind(conn.dst);
+        if (src == shapeIndex.constEnd() || dst == shapeIndex.constEnd()) continue;
+
+        QJsonObject connObj;
+        connObj["src"] = src.value();
+        connObj["dst"] = dst.value();
+        connObj["color"] = conn.color.name(QColor::HexArgb);
+        connObj["width"] = conn.width;
+        connObj["bidirectional"] = conn.bidirectional;
+        write(first ? "\n        " : ",\n        ");
+        ok = ok && writeCompact(out, connObj);
+        first = false;
+    }
+    write(first ? "]" : "\n    ]");
+    write("\n}\n");
+    return ok;
+}
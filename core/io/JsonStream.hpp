@@ -0,0 +1,68 @@
+#pragma once
+#include <QByteArray>
+#include <QJsonValue>
+#include <QString>
+#include <vector>
+
+class Document;
+class QIODevice;
+
+/* 流式 JSON 读写
+   大文档加载时不再同时持有原始字节、整棵 QJsonDocument 和图形对象：
+   读取端按块从设备读入，逐个解析图形记录并立即构建图形；
+   写入端逐个图形序列化后直接写入设备。文件结构与 Document::toJson 相同。 */
+
+// JSON 拉取式解析器：调用方按文档结构依次请求对象、键、数组元素和值
+class JsonStreamReader
+{
+public:
+    explicit JsonStreamReader(QIODevice* device);
+
+    // 读取 '{'，之后用 nextKey 遍历成员
+    bool beginObject();
+    // 读取下一个键（含冒号）；遇到 '}' 时消费并返回 false
+    bool nextKey(QString& key);
+    // 读取 '['，之后用 nextElement 遍历元素
+    bool beginArray();
+    // 还有下一个元素时返回 true；遇到 ']' 时消费并返回 false
+    bool nextElement();
+    // 下一个值是否为数组（不消费）
+    bool nextIsArray();
+
+    // 读取一个完整的值（对象/数组会构建成 QJsonValue）
+    bool readValue(QJsonValue& value);
+    // 跳过一个值，不构建任何对象
+    bool skipValue();
+    // 只扫描结构、不解析内容，把下一个值的原始字节追加到 out（交给其他线程解析）
+    bool readRawValue(QByteArray& out);
+
+    bool hasError() const { return !error_.isEmpty(); }
+    QString errorString() const { return error_; }
+
+private:
+    bool fill();                   // 缓冲区读完时从设备补充
+    bool peekChar(char& c);        // 跳过空白后查看下一个字符
+    bool expect(char c);
+    bool readString(QString& s);
+    bool readNumber(double& d);
+    bool readLiteral(const char* word);
+    bool readValueAt(QJsonValue& value, int depth);
+    bool skipValueAt(int depth);
+    bool setError(const QString& message);
+
+    QIODevice*        device_;
+    QByteArray        buffer_;
+    int               pos_ = 0;
+    std::vector<bool> first_;      // 每层容器是否尚未读取任何成员
+    QString           error_;
+};
+
+class LoadSink;
+
+// 流式读取 JSON 文档，失败时 doc 保持不变
+// 图形数组按块分发到工作线程并行解析和构建，结果按原顺序拼接，z-order 不变
+bool readJsonDocument(QIODevice& in, Document& doc);
+// 渐进读取：页面设置、按文档顺序分批的图形、连接线依次交给 sink（在调用线程中回调）
+bool readJsonProgressive(QIODevice& in, LoadSink& sink);
+// 流式写入 JSON 文档，每个图形一行
+bool writeJsonDocument(const Document& doc, QIODevice& out);
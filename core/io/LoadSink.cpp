@@ -0,0 +1,105 @@
+#include "LoadSink.hpp"
+#include "BinaryFormat.hpp"
+#include "CompressedFormat.hpp"
+#include "JsonStream.hpp"
+#include "model/Document.hpp"
+
+#include <QBuffer>
+#include <QFile>
+
+DocumentSink::DocumentSink(Document& doc)
+    : doc_(doc),
+      backgroundColor_(doc.backgroundColor),
+      pageSize_(doc.pageSize),
+      showGrid_(doc.showGrid)
+{
+}
+
+void DocumentSink::page(const QColor& backgroundColor, const QSize& pageSize, bool showGrid)
+{
+    backgroundColor_ = backgroundColor;
+    pageSize_ = pageSize;
+    showGrid_ = showGrid;
+}
+
+void DocumentSink::shapes(std::vector<LoadedShape>&& batch)
+{
+    for (LoadedShape& loaded : batch) {
+        if (loaded.index < 0) continue;
+        if (loaded.index >= static_cast<int>(shapes_.size())) shapes_.resize(loaded.index + 1);
+        shapes_[loaded.index] = std::move(loaded.shape);
+    }
+}
+
+void DocumentSink::connectors(std::vector<ConnectorSpec>&& list)
+{
+    connectors_ = std::move(list);
+}
+
+void DocumentSink::commit()
+{
+    doc_.clear();
+    doc_.backgroundColor = backgroundColor_;
+    doc_.pageSize = pageSize_;
+    doc_.showGrid = showGrid_;
+
+    // 连接线先按加载时的索引连接，再去掉空位
+    QVector<Connector> connectors;
+    connectors.reserve(static_cast<int>(connectors_.size()));
+    for (const ConnectorSpec& spec : connectors_) {
+        if (spec.src < 0 || spec.src >= static_cast<int>(shapes_.size()) ||
+            spec.dst < 0 || spec.dst >= static_cast<int>(shapes_.size()) ||
+            !shapes_[spec.src] || !shapes_[spec.dst]) {
+            continue;
+        }
+        Connector conn;
+        conn.src = shapes_[spec.src].get();
+        conn.dst = shapes_[spec.dst].get();
+        conn.color = spec.color;
+        conn.width = spec.width;
+        conn.bidirectional = spec.bidirectional;
+        connectors.push_back(conn);
+    }
+
+    doc_.shapes.reserve(static_cast<int>(shapes_.size()));
+    for (auto& shape : shapes_) {
+        if (shape) doc_.shapes.push_back(std::move(shape));
+    }
+    doc_.connectors = std::move(connectors);
+    shapes_.clear();
+    connectors_.clear();
+}
+
+bool loadDocumentProgressive(const QString& filename, LoadSink& sink, const QRectF& priority)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    if (binfmt::isBinaryDocument(file.peek(4))) {
+        bool ok = false;
+        if (uchar* mapped = file.map(0, file.size())) {
+            ok = binfmt::readBinaryProgressive(mapped, file.size(), sink, priority);
+            file.unmap(mapped);
+        } else {
+            const QByteArray data = file.readAll();
+            ok = binfmt::readBinaryProgressive(reinterpret_cast<const uchar*>(data.constData()),
+                                               data.size(), sink, priority);
+        }
+        return ok;
+    }
+
+    // 压缩格式：整体解压（并行）后按 JSON 渐进交付
+    if (zfmt::isCompressedDocument(file.peek(4))) {
+        QByteArray json;
+        if (!zfmt::decompressFile(file, json)) {
+            return false;
+        }
+        QBuffer buffer(&json);
+        buffer.open(QIODevice::ReadOnly);
+        return readJsonProgressive(buffer, sink);
+    }
+
+    return readJsonProgressive(file, sink);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <QColor>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <memory>
+#include <vector>
+
+#include "model/Shape.hpp"
+
+class Document;
+
+// 渐进加载中交付的一个图形，index 为它在文档中的最终位置（即 z-order）
+struct LoadedShape {
+    int index = -1;
+    std::unique_ptr<Shape> shape;
+};
+
+// 以图形索引表示两端的连接线，所有图形交付后才会交付
+struct ConnectorSpec {
+    int    src = -1;
+    int    dst = -1;
+    QColor color = Qt::black;
+    qreal  width = 1.0;
+    bool   bidirectional = false;
+};
+
+/* 渐进加载的接收端
+   读取函数在自己的线程中依次回调：page → 若干批 shapes → connectors。
+   图形批次可能不按索引顺序到达（二进制格式会先交付可见区域内的图形）。 */
+class LoadSink
+{
+public:
+    virtual ~LoadSink() = default;
+
+    virtual void page(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) = 0;
+    virtual void shapes(std::vector<LoadedShape>&& batch) = 0;
+    virtual void connectors(std::vector<ConnectorSpec>&& list) = 0;
+    // 进度：done / total 的单位由格式决定（字节或图形数）
+    virtual void progress(qint64 done, qint64 total) { Q_UNUSED(done); Q_UNUSED(total); }
+    // 返回 true 时读取函数尽快放弃并返回 false
+    virtual bool cancelled() const { return false; }
+};
+
+/* 把渐进交付的内容收集起来，commit() 时一次性替换到文档中
+   用于同步加载：读取失败时不调用 commit，文档保持不变 */
+class DocumentSink : public LoadSink
+{
+public:
+    explicit DocumentSink(Document& doc);
+
+    void page(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) override;
+    void shapes(std::vector<LoadedShape>&& batch) override;
+    void connectors(std::vector<ConnectorSpec>&& list) override;
+
+    void commit();
+
+private:
+    Document& doc_;
+    QColor backgroundColor_;
+    QSize  pageSize_;
+    bool   showGrid_;
+    std::vector<std::unique_ptr<Shape>> shapes_;
+    std::vector<ConnectorSpec>          connectors_;
+};
+
+// 按文件头识别格式并渐进加载；priority 非空且格式带有图形坐标索引（.fdb）时，先交付与之相交的图形
+bool loadDocumentProgressive(const QString& filename, LoadSink& sink, const QRectF& priority = QRectF());
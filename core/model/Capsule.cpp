@@ -1,19 +1,15 @@
 #include "Capsule.hpp"
 #include <QPainterPath>
 #include <cmath>
+#include "ColorParse.hpp"
 
 // 在Windows平台上定义M_PI（如果尚未定义）
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-void Capsule::paint(QPainter& p, bool selected) const
+QPainterPath Capsule::outline() const
 {
-    // 绘制胶囊形状（两端为半圆形，中间为矩形）
-    QPen pen(strokeColor, strokeWidth);
-    p.setPen(pen);
-    p.setBrush(fillColor);
-    
     // 创建胶囊路径
     QPainterPath path;
     
@@ -53,29 +49,39 @@ void Capsule::paint(QPainter& p, bool selected) const
         path.arcTo(bottomCircle, 0, -180);                                   // 下半圆：从0度开始，逆时针旋转180度
         path.closeSubpath();
     }
-    
-    p.drawPath(path);
+    return path;
+}
+
+void Capsule::paint(QPainter& p, bool selected, bool withText) const
+{
+    // 绘制胶囊形状（两端为半圆形，中间为矩形）
+    p.setPen(style->pen);
+    p.setBrush(style->brush);
+    p.drawPath(outline());
     
     // 绘制文本
-    drawText(p);
+    if (withText) drawText(p);
 
     // 如果被选中，绘制虚线框，适应胶囊形状
-    if (selected) {
-        QPen dashPen(Qt::DashLine);
-        dashPen.setColor(Qt::blue);
-        p.setPen(dashPen);
-        p.setBrush(Qt::NoBrush);
-        
-        // 使用稍微放大的路径绘制选中框
-        QPainterPath selectionPath = path;
-        QTransform transform;
-        transform.translate(bounds.center().x(), bounds.center().y());
-        transform.scale(1.04, 1.04); // 比实际形状稍大
-        transform.translate(-bounds.center().x(), -bounds.center().y());
-        selectionPath = transform.map(selectionPath);
-        
-        p.drawPath(selectionPath);
-    }
+    if (selected) paintSelection(p);
+}
+
+void Capsule::paintSelection(QPainter& p) const
+{
+    QPen dashPen(Qt::DashLine);
+    dashPen.setColor(Qt::blue);
+    p.setPen(dashPen);
+    p.setBrush(Qt::NoBrush);
+    
+    // 使用稍微放大的路径绘制选中框
+    QPainterPath selectionPath = outline();
+    QTransform transform;
+    transform.translate(bounds.center().x(), bounds.center().y());
+    transform.scale(1.04, 1.04); // 比实际形状稍大
+    transform.translate(-bounds.center().x(), -bounds.center().y());
+    selectionPath = transform.map(selectionPath);
+    
+    p.drawPath(selectionPath);
 }
 
 bool Capsule::hitTest(const QPointF& pt) const
@@ -227,12 +233,12 @@ QJsonObject Capsule::toJson() const
         {"type", "capsule"},
         {"x", bounds.x()}, {"y", bounds.y()},
         {"w", bounds.width()}, {"h", bounds.height()},
-        {"fill", fillColor.name(QColor::HexArgb)},
-        {"stroke", strokeColor.name(QColor::HexArgb)},
-        {"width", strokeWidth},
+        {"fill", fillColor().name(QColor::HexArgb)},
+        {"stroke", strokeColor().name(QColor::HexArgb)},
+        {"width", strokeWidth()},
         {"text", text},
-        {"textColor", textColor.name(QColor::HexArgb)},
-        {"textSize", textSize}
+        {"textColor", textColor().name(QColor::HexArgb)},
+        {"textSize", textSize()}
     };
 }
 
@@ -240,10 +246,12 @@ void Capsule::fromJson(const QJsonObject& o)
 {
     bounds = { o["x"].toDouble(), o["y"].toDouble(),
                o["w"].toDouble(), o["h"].toDouble() };
-    fillColor = QColor(o["fill"].toString("#ffffffff"));
-    strokeColor = QColor(o["stroke"].toString("#ff000000"));
-    strokeWidth = o["width"].toDouble(1.5);
+    Style st;
+    st.fillColor = parseColor(o["fill"].toString("#ffffffff"));
+    st.strokeColor = parseColor(o["stroke"].toString("#ff000000"));
+    st.strokeWidth = o["width"].toDouble(1.5);
+    st.textColor = parseColor(o["textColor"].toString("#ff000000"));
+    st.textSize = o["textSize"].toInt(10);
+    style = Style::intern(st);
     text = o["text"].toString();
-    textColor = QColor(o["textColor"].toString("#ff000000"));
-    textSize = o["textSize"].toInt(10);
 } 
\ No newline at end of file
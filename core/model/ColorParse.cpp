@@ -0,0 +1,29 @@
+#include "ColorParse.hpp"
+
+static inline int hexDigit(ushort c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+QColor parseColor(const QString& name)
+{
+    const int len = name.size();
+    if ((len == 9 || len == 7) && name.at(0) == QLatin1Char('#')) {
+        const ushort* d = name.utf16() + 1;
+        quint32 value = 0;
+        bool ok = true;
+        for (int i = 0; i < len - 1; ++i) {
+            int h = hexDigit(d[i]);
+            if (h < 0) { ok = false; break; }
+            value = (value << 4) | static_cast<quint32>(h);
+        }
+        if (ok) {
+            return len == 9 ? QColor::fromRgba(value)
+                            : QColor::fromRgb(static_cast<QRgb>(value | 0xff000000u));
+        }
+    }
+    return QColor(name);
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <QColor>
+#include <QString>
+
+// 快速解析文档中的颜色字符串。
+// 对保存时使用的 "#AARRGGBB"，以及 "#RRGGBB"，直接按十六进制解析；
+// 其他写法（颜色名、#RGB 等）交给 QColor 处理，结果与 QColor(name) 一致。
+QColor parseColor(const QString& name);
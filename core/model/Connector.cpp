@@ -49,7 +49,7 @@ void Connector::drawArrow(QPainter& p, const QPointF& from, const QPointF& to) c
     p.setBrush(originalBrush);
 }
 
-void Connector::paint(QPainter& p) const
+void Connector::paint(QPainter& p, bool withArrows) const
 {
     if (!src) return;
 
@@ -70,6 +70,7 @@ void Connector::paint(QPainter& p) const
     // 增加线宽，使连接线更明显
     p.setPen(QPen(color, width));
     p.drawLine(p1, p2);
+    if (!withArrows) return;
     
     // 绘制终点箭头
     drawArrow(p, p1, p2);
@@ -6,8 +6,8 @@
 class Connector
 {
 public:
-    Shape* src = nullptr;   // 起点图形
-    Shape* dst = nullptr;   // 终点图形
+    const Shape* src = nullptr;   // 起点图形
+    const Shape* dst = nullptr;   // 终点图形
     QPointF tempEnd;        // 绘制过程中的临时终点
     
     // 添加颜色和宽度属性
@@ -17,7 +17,8 @@ public:
     // 箭头类型
     bool bidirectional = false; // 是否为双向箭头
 
-    void paint(QPainter& p) const;
+    // withArrows 为 false 时只画线（缩小到箭头无法辨认时）
+    void paint(QPainter& p, bool withArrows = true) const;
 
 private:
     QPointF anchorPoint(const Shape* s, const QPointF& ref) const;
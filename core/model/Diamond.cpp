@@ -1,8 +1,9 @@
 #include "Diamond.hpp"
 #include <QPainterPath>
 #include <limits>
+#include "ColorParse.hpp"
 
-void Diamond::paint(QPainter& p, bool selected) const
+void Diamond::paint(QPainter& p, bool selected, bool withText) const
 {
     // 创建菱形路径
     QPainterPath path;
@@ -22,22 +23,15 @@ void Diamond::paint(QPainter& p, bool selected) const
     path.closeSubpath();
     
     // 绘制菱形
-    QPen pen(strokeColor, strokeWidth);
-    p.setPen(pen);
-    p.setBrush(fillColor);
+    p.setPen(style->pen);
+    p.setBrush(style->brush);
     p.drawPath(path);
     
     // 绘制文本
-    drawText(p);
+    if (withText) drawText(p);
 
     // 如果被选中，绘制虚线框
-    if (selected) {
-        QPen dashPen(Qt::DashLine);
-        dashPen.setColor(Qt::blue);
-        p.setPen(dashPen);
-        p.setBrush(Qt::NoBrush);
-        p.drawRect(bounds.adjusted(-2, -2, 2, 2));
-    }
+    if (selected) paintSelection(p);
 }
 
 bool Diamond::hitTest(const QPointF& pt) const
@@ -154,12 +148,12 @@ QJsonObject Diamond::toJson() const
         {"type", "diamond"},
         {"x", bounds.x()}, {"y", bounds.y()},
         {"w", bounds.width()}, {"h", bounds.height()},
-        {"fill", fillColor.name(QColor::HexArgb)},
-        {"stroke", strokeColor.name(QColor::HexArgb)},
-        {"width", strokeWidth},
+        {"fill", fillColor().name(QColor::HexArgb)},
+        {"stroke", strokeColor().name(QColor::HexArgb)},
+        {"width", strokeWidth()},
         {"text", text},
-        {"textColor", textColor.name(QColor::HexArgb)},
-        {"textSize", textSize}
+        {"textColor", textColor().name(QColor::HexArgb)},
+        {"textSize", textSize()}
     };
 }
 
@@ -167,10 +161,12 @@ void Diamond::fromJson(const QJsonObject& o)
 {
     bounds = { o["x"].toDouble(), o["y"].toDouble(),
                o["w"].toDouble(), o["h"].toDouble() };
-    fillColor = QColor(o["fill"].toString("#ffffffff"));
-    strokeColor = QColor(o["stroke"].toString("#ff000000"));
-    strokeWidth = o["width"].toDouble(1.5);
+    Style st;
+    st.fillColor = parseColor(o["fill"].toString("#ffffffff"));
+    st.strokeColor = parseColor(o["stroke"].toString("#ff000000"));
+    st.strokeWidth = o["width"].toDouble(1.5);
+    st.textColor = parseColor(o["textColor"].toString("#ff000000"));
+    st.textSize = o["textSize"].toInt(10);
+    style = Style::intern(st);
     text = o["text"].toString();
-    textColor = QColor(o["textColor"].toString("#ff000000"));
-    textSize = o["textSize"].toInt(10);
 } 
\ No newline at end of file
@@ -0,0 +1,805 @@
+#include "Document.hpp"
+#include "ShapeFactory.hpp"
+#include "ColorParse.hpp"
+#include "trace/Trace.hpp"
+#include "io/BinaryFormat.hpp"
+#include "io/CompressedFormat.hpp"
+#include "io/JsonStream.hpp"
+
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QPainter>
+#include <QSvgGenerator>
+#include <algorithm>
+#include <cmath>
+
+bool Document::saveToFile(const QString& filename, const SaveOptions& options) const
+{
+    TraceSpan span("Document::saveToFile", "io");
+    span.arg("shapes", static_cast<int>(shapes.size()))
+        .arg("connectors", static_cast<int>(connectors.size()));
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    // .fdb 后缀保存为二进制格式
+    if (isBinaryFileName(filename)) {
+        bool ok = binfmt::writeBinaryDocument(*this, file);
+        span.arg("bytes", file.size()).arg("binary", true);
+        return ok;
+    }
+
+    // .fdz 后缀保存为分块压缩的 JSON
+    if (isCompressedFileName(filename)) {
+        bool ok = zfmt::writeCompressedDocument(*this, file, options.compressionLevel, options.compressionChunkSize);
+        span.arg("bytes", file.size()).arg("level", options.compressionLevel);
+        return ok;
+    }
+
+    // JSON：逐个图形写出，不在内存中构建整个文档
+    bool ok = writeJsonDocument(*this, file);
+    span.arg("bytes", file.size());
+    return ok;
+}
+
+bool Document::loadFromFile(const QString& filename)
+{
+    TraceSpan span("Document::loadFromFile", "io");
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // 二进制格式：映射到内存后直接读取定长记录
+    if (binfmt::isBinaryDocument(file.peek(4))) {
+        span.arg("bytes", file.size()).arg("binary", true);
+        bool ok = false;
+        if (uchar* mapped = file.map(0, file.size())) {
+            ok = binfmt::readBinaryDocument(mapped, file.size(), *this);
+            file.unmap(mapped);
+        } else {
+            const QByteArray data = file.readAll();   // 无法映射时（如某些网络文件系统）退回普通读取
+            ok = binfmt::readBinaryDocument(reinterpret_cast<const uchar*>(data.constData()), data.size(), *this);
+        }
+        span.arg("shapes", static_cast<int>(shapes.size()));
+        return ok;
+    }
+
+    // 压缩格式：并行解压后按 JSON 解析
+    if (zfmt::isCompressedDocument(file.peek(4))) {
+        span.arg("bytes", file.size()).arg("compressed", true);
+        QByteArray json;
+        if (!zfmt::decompressFile(file, json)) {
+            return false;
+        }
+        QBuffer buffer(&json);
+        buffer.open(QIODevice::ReadOnly);
+        if (!readJsonDocument(buffer, *this)) {
+            return false;
+        }
+        span.arg("shapes", static_cast<int>(shapes.size()))
+            .arg("connectors", static_cast<int>(connectors.size()));
+        return true;
+    }
+
+    // JSON：边读边解析，逐个构建图形
+    span.arg("bytes", file.size());
+    if (!readJsonDocument(file, *this)) {
+        return false;
+    }
+    span.arg("shapes", static_cast<int>(shapes.size()))
+        .arg("connectors", static_cast<int>(connectors.size()));
+    return true;
+}
+
+bool Document::isBinaryFileName(const QString& filename)
+{
+    return QFileInfo(filename).suffix().compare("fdb", Qt::CaseInsensitive) == 0;
+}
+
+bool Document::isCompressedFileName(const QString& filename)
+{
+    return QFileInfo(filename).suffix().compare("fdz", Qt::CaseInsensitive) == 0;
+}
+
+QJsonObject Document::toJson() const
+{
+    QJsonObject root;
+
+    // 保存页面属性
+    QJsonObject pageObj;
+    pageObj["backgroundColor"] = backgroundColor.name(QColor::HexArgb);
+    pageObj["width"] = pageSize.width();
+    pageObj["height"] = pageSize.height();
+    pageObj["showGrid"] = showGrid;
+    root["page"] = pageObj;
+
+    // 保存所有图形
+    QJsonArray shapesArray;
+    for (const auto& shape : shapes) {
+        shapesArray.append(shape->toJson());
+    }
+    root["shapes"] = shapesArray;
+
+    // 保存所有连接线（以图形索引表示两端）
+    QJsonArray connArray;
+    for (const auto& conn : connectors) {
+        int srcIdx = indexOf(conn.src);
+        int dstIdx = indexOf(conn.dst);
+
+        if (srcIdx >= 0 && dstIdx >= 0) {
+            QJsonObject connObj;
+            connObj["src"] = srcIdx;
+            connObj["dst"] = dstIdx;
+            connObj["color"] = conn.color.name(QColor::HexArgb);
+            connObj["width"] = conn.width;
+            connObj["bidirectional"] = conn.bidirectional;
+            connArray.append(connObj);
+        }
+    }
+    root["connectors"] = connArray;
+
+    return root;
+}
+
+void Document::fromJson(const QJsonObject& root)
+{
+    clear();
+
+    // 加载页面属性
+    if (root.contains("page") && root["page"].isObject()) {
+        QJsonObject pageObj = root["page"].toObject();
+        backgroundColor = parseColor(pageObj["backgroundColor"].toString("#fdfdfd"));
+        pageSize = QSize(
+            pageObj["width"].toInt(2000),
+            pageObj["height"].toInt(2000)
+        );
+        showGrid = pageObj["showGrid"].toBool(true);
+    }
+
+    // 加载图形
+    if (root.contains("shapes") && root["shapes"].isArray()) {
+        QJsonArray shapesArray = root["shapes"].toArray();
+        shapes.reserve(shapesArray.size());
+        for (const QJsonValue& val : shapesArray) {
+            if (!val.isObject()) continue;
+
+            auto shape = createShapeFromJson(val.toObject());
+            if (shape) {
+                shapes.push_back(std::move(shape));
+            }
+        }
+    }
+
+    // 加载连接线
+    if (root.contains("connectors") && root["connectors"].isArray()) {
+        QJsonArray connArray = root["connectors"].toArray();
+        for (const QJsonValue& val : connArray) {
+            if (!val.isObject()) continue;
+
+            QJsonObject connObj = val.toObject();
+            int srcIdx = connObj["src"].toInt(-1);
+            int dstIdx = connObj["dst"].toInt(-1);
+
+            if (srcIdx >= 0 && srcIdx < static_cast<int>(shapes.size()) &&
+                dstIdx >= 0 && dstIdx < static_cast<int>(shapes.size())) {
+                Connector conn;
+                conn.src = shapes[srcIdx];
+                conn.dst = shapes[dstIdx];
+                conn.color = parseColor(connObj["color"].toString("#ff000000"));
+                conn.width = connObj["width"].toDouble(1.0);
+                conn.bidirectional = connObj["bidirectional"].toBool(false);
+                connectors.push_back(conn);
+            }
+        }
+    }
+}
+
+void Document::clear()
+{
+    connectors.clear();
+    shapes.clear();
+}
+
+std::shared_ptr<const Document> Document::snapshot() const
+{
+    auto snap = std::make_shared<Document>();
+    snap->shapes = shapes;           // 只复制块表指针
+    snap->connectors = connectors;   // 隐式共享
+    snap->backgroundColor = backgroundColor;
+    snap->pageSize = pageSize;
+    snap->showGrid = showGrid;
+    return snap;
+}
+
+Shape* Document::editShape(int index)
+{
+    const Shape* old = shapes[index];
+    Shape* shape = shapes.detach(index);
+    if (shape != old) retargetConnectors(old, shape);
+    return shape;
+}
+
+void Document::retargetConnectors(const Shape* from, const Shape* to)
+{
+    for (int i = 0; i < connectors.size(); ++i) {
+        const Connector& c = connectors.at(i);   // 只读访问，没有指向 from 的连接线时不复制
+        if (c.src != from && c.dst != from) continue;
+        Connector& conn = connectors[i];
+        if (conn.src == from) conn.src = to;
+        if (conn.dst == from) conn.dst = to;
+    }
+}
+
+int Document::indexOf(const Shape* shape) const
+{
+    return shapes.indexOf(shape);
+}
+
+QRectF Document::contentBounds() const
+{
+    QRectF bounds;
+    for (const Shape* s : shapes) {
+        bounds |= s->bounds.normalized();
+    }
+    return bounds;
+}
+
+void Document::drawGrid(QPainter& p, const QRectF& area) const
+{
+    const int step = 20;
+    // 无边界画布的网格铺满整个区域
+    QRectF r = isUnbounded() ? area : area.intersected(pageRect());
+    if (r.isEmpty()) return;
+
+    p.setPen(QColor(220, 220, 220));
+
+    // 只绘制落在区域内的网格线，起点对齐到网格
+    int startX = static_cast<int>(std::floor(r.left() / step)) * step;
+    int startY = static_cast<int>(std::floor(r.top() / step)) * step;
+    for (int x = startX; x <= r.right(); x += step)
+        p.drawLine(QPointF(x, r.top()), QPointF(x, r.bottom()));
+    for (int y = startY; y <= r.bottom(); y += step)
+        p.drawLine(QPointF(r.left(), y), QPointF(r.right(), y));
+}
+
+void Document::render(QPainter& p, const QRectF& region, bool withGrid) const
+{
+    // 背景
+    p.fillRect(region, backgroundColor);
+
+    // 网格
+    if (showGrid && withGrid) {
+        drawGrid(p, region);
+    }
+
+    // 连接线（先画连接线再画图形）
+    drawConnectors(p);
+
+    // 图形
+    drawShapes(p);
+}
+
+int Document::drawConnectors(QPainter& p, const QRectF& visible, const LodOptions& lod, const Shape* exclude) const
+{
+    return drawConnectorRange(p, 0, connectors.size(), visible, lod, exclude);
+}
+
+int Document::drawConnectorRange(QPainter& p, int first, int last, const QRectF& visible,
+                                 const LodOptions& lod, const Shape* exclude) const
+{
+    // 箭头长 12 个文档单位，缩小后太小时只画线
+    const bool arrows = !lod.enabled || 12 * std::abs(p.worldTransform().m11()) >= lod.arrowPixels;
+
+    int drawn = 0;
+    last = qMin(last, connectors.size());
+    for (int i = qMax(0, first); i < last; ++i) {
+        const Connector& c = connectors[i];
+        if (exclude && (c.src == exclude || c.dst == exclude)) continue;
+        if (!visible.isNull() && c.src && c.dst) {
+            // 连接线总在两端图形的外接矩形内，再留出线宽和箭头的余量
+            qreal margin = c.width + 12;
+            QRectF area = c.src->bounds.united(c.dst->bounds).adjusted(-margin, -margin, margin, margin);
+            if (!area.intersects(visible)) continue;
+        }
+        c.paint(p, arrows);
+        ++drawn;
+    }
+    return drawn;
+}
+
+int Document::drawShapes(QPainter& p, int selectedIndex, const QRectF& visible, const LodOptions& lod,
+                         const Shape* exclude) const
+{
+    return drawShapeRange(p, 0, shapes.size(), selectedIndex, visible, lod, exclude);
+}
+
+int Document::drawShapeRange(QPainter& p, int first, int last, int selectedIndex, const QRectF& visible,
+                             const LodOptions& lod, const Shape* exclude) const
+{
+    const qreal scale = std::abs(p.worldTransform().m11());
+    const Style* simpleStyle = nullptr;          // 简化绘制当前使用的样式，相同时不切换画笔
+    QHash<QRgb, QVector<QPointF>> points;        // 最远一级的点，按颜色分批绘制
+    QRectF pointsArea;                           // 还没画出的点覆盖的范围（含点的大小）
+    const qreal pointRadius = scale > 0 ? qMax<qreal>(1, lod.pointPixels) / scale : 0;
+
+    // 相邻的一串点之间看不出先后顺序，同色的点一次画完；后面的图形盖住它们之前必须先画出来
+    auto flushPoints = [&]() {
+        if (points.isEmpty()) return;
+        for (auto it = points.cbegin(); it != points.cend(); ++it) {
+            QPen pen(QColor::fromRgba(it.key()), qMax<qreal>(1, lod.pointPixels));
+            pen.setCosmetic(true);
+            p.setPen(pen);
+            p.drawPoints(it.value().constData(), it.value().size());
+        }
+        points.clear();
+        pointsArea = QRectF();
+        simpleStyle = nullptr;
+    };
+
+    int drawn = 0;
+    first = qMax(0, first);
+    last = qMin(last, shapes.size());
+    int i = first;
+    for (auto it = shapes.iteratorAt(first); i < last; ++it, ++i) {
+        const Shape* s = *it;
+        if (s == exclude) continue;
+        if (!visible.isNull()) {
+            // 包含描边宽度和选中虚线框的余量
+            qreal margin = s->strokeWidth() + 4;
+            if (!s->bounds.normalized().adjusted(-margin, -margin, margin, margin).intersects(visible)) continue;
+        }
+        ++drawn;
+
+        if (!lod.enabled) {
+            s->paint(p, i == selectedIndex);
+            continue;
+        }
+        const qreal pixels = qMax(std::abs(s->bounds.width()), std::abs(s->bounds.height())) * scale;
+        if (pixels < lod.pointPixels) {
+            const QPointF center = s->bounds.center();
+            points[s->strokeColor().rgba()].push_back(center);
+            pointsArea |= QRectF(center, center).adjusted(-pointRadius, -pointRadius, pointRadius, pointRadius);
+            continue;
+        }
+        // 压在还没画出的点上的图形：先画出这些点，保持层级顺序
+        if (!pointsArea.isNull()) {
+            const qreal margin = s->strokeWidth();
+            if (s->bounds.normalized().adjusted(-margin, -margin, margin, margin).intersects(pointsArea)) {
+                flushPoints();
+            }
+        }
+        if (pixels < lod.shapePixels) {
+            if (s->style != simpleStyle) {
+                simpleStyle = s->style;
+                p.setPen(QPen(simpleStyle->strokeColor, 0));   // 1 像素宽的细线
+                p.setBrush(simpleStyle->brush);
+            }
+            p.drawRect(s->bounds);
+        } else {
+            s->paint(p, i == selectedIndex, pixels >= lod.textPixels);
+            simpleStyle = nullptr;
+        }
+    }
+
+    flushPoints();
+    return drawn;
+}
+
+QRectF Document::exportRegion(const RenderOptions& options) const
+{
+    if (options.region.isValid() && !options.region.isEmpty()) {
+        return options.region;
+    }
+    if (isUnbounded()) {
+        // 无边界画布按内容裁剪，四周留出描边和箭头的余量；空文档导出一小块背景
+        const qreal margin = 20;
+        const QRectF content = contentBounds();
+        if (content.isNull()) return QRectF(0, 0, 100, 100);
+        return content.adjusted(-margin, -margin, margin, margin);
+    }
+    return pageRect();
+}
+
+bool Document::exportToPng(const QString& filename, const RenderOptions& options) const
+{
+    TraceSpan span("Document::exportToPng", "io");
+
+    const QRectF region = exportRegion(options);
+    const int dpi = options.dpi > 0 ? options.dpi : 96;
+    const qreal scale = options.zoom * dpi / 96.0;
+    const qreal ratio = options.pixelRatio;
+    if (scale <= 0 || ratio <= 0) return false;
+
+    QSize size = (region.size() * scale * ratio).toSize().expandedTo(QSize(1, 1));
+    span.arg("shapes", static_cast<int>(shapes.size()))
+        .arg("width", size.width())
+        .arg("height", size.height());
+    QImage image(size, QImage::Format_ARGB32);
+    if (image.isNull()) {
+        return false;   // 尺寸过大，无法分配内存
+    }
+    image.setDevicePixelRatio(ratio);   // QPainter 自动按像素比放大，下面仍按逻辑像素绘制
+    image.fill(backgroundColor);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.scale(scale, scale);
+    painter.translate(-region.topLeft());
+    render(painter, region, options.drawGrid);
+    painter.end();
+
+    // 绘制完成后再写入分辨率，避免字体按输出 DPI 再放大一次
+    const int dotsPerMeter = qRound(dpi * ratio / 0.0254);
+    image.setDotsPerMeterX(dotsPerMeter);
+    image.setDotsPerMeterY(dotsPerMeter);
+
+    return image.save(filename, "PNG");
+}
+
+bool Document::exportToSvg(const QString& filename, const RenderOptions& options) const
+{
+    TraceSpan span("Document::exportToSvg", "io");
+
+    const QRectF region = exportRegion(options);
+    const qreal scale = options.zoom;
+    if (scale <= 0) return false;
+
+    QSize size = (region.size() * scale).toSize().expandedTo(QSize(1, 1));
+    span.arg("shapes", static_cast<int>(shapes.size()))
+        .arg("width", size.width())
+        .arg("height", size.height());
+
+    QSvgGenerator generator;
+    generator.setFileName(filename);
+    generator.setSize(size);
+    generator.setViewBox(QRect(QPoint(0, 0), size));
+    generator.setResolution(options.dpi > 0 ? options.dpi : 96);
+    generator.setTitle("FlowDraw Diagram");
+    generator.setDescription("Created with FlowDraw");
+
+    QPainter painter;
+    if (!painter.begin(&generator)) {
+        return false;
+    }
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.scale(scale, scale);
+    painter.translate(-region.topLeft());
+    render(painter, region, options.drawGrid);
+    return painter.end();
+}
+
+/* ---------- 撤销 / 重做 ---------- */
+
+// 估算一个状态对象占用的内存：每个键值按固定开销计，再加上字符串的长度（不序列化，每次编辑都要调用）
+static qint64 estimateStateBytes(const QJsonObject& state)
+{
+    constexpr qint64 EntryBytes = 32;   // 键和值的固定开销
+    qint64 bytes = 0;
+    for (auto it = state.constBegin(); it != state.constEnd(); ++it) {
+        bytes += EntryBytes + it.key().size() * 2;
+        if (it.value().isString()) {
+            bytes += it.value().toString().size() * 2;
+        } else if (it.value().isObject()) {
+            bytes += estimateStateBytes(it.value().toObject());
+        } else if (it.value().isArray()) {
+            bytes += it.value().toArray().size() * EntryBytes;
+        }
+    }
+    return bytes;
+}
+
+// 估算一条操作记录占用的内存
+static qint64 estimateRecordBytes(const ActionRecord& record)
+{
+    return sizeof(ActionRecord) + estimateStateBytes(record.stateBefore) + estimateStateBytes(record.stateAfter);
+}
+
+// 连接线属性记录只包含颜色、宽度和箭头方向
+static QJsonObject connectorState(const Connector& conn)
+{
+    QJsonObject connObj;
+    connObj["color"] = conn.color.name();
+    connObj["width"] = conn.width;
+    connObj["bidirectional"] = conn.bidirectional;
+    return connObj;
+}
+
+// 记录操作历史
+void Document::recordAction(ActionType type, int elementIndex, const QJsonObject& before, const QJsonObject& after)
+{
+    if (isUndoRedoing_) return; // 如果是在执行撤销/重做操作，不记录
+
+    ActionRecord record;
+    record.type = type;
+    record.elementIndex = elementIndex;
+    record.stateBefore = before;
+    record.stateAfter = after;
+
+    pushAction(record);
+}
+
+// 记录连接线操作历史
+void Document::recordConnectorAction(ActionType type, int connIndex, int srcIndex, int dstIndex)
+{
+    if (isUndoRedoing_) return;
+
+    ActionRecord record;
+    record.type = type;
+    record.elementIndex = connIndex;
+    record.srcIndex = srcIndex;
+    record.dstIndex = dstIndex;
+
+    bool valid = connIndex >= 0 && connIndex < static_cast<int>(connectors.size());
+    if (type == ActionType::AddConn && valid) {
+        // 添加连接线操作，记录连接线的属性
+        record.stateAfter = connectorState(connectors[connIndex]);
+    } else if (type == ActionType::DeleteConn && valid) {
+        // 删除连接线操作，记录被删除连接线的属性
+        record.stateBefore = connectorState(connectors[connIndex]);
+    }
+
+    pushAction(record);
+}
+
+void Document::pushAction(const ActionRecord& record)
+{
+    if (isUndoRedoing_) return;
+
+    undoStack_.push(record);
+    historyBytes_ += estimateRecordBytes(record);
+    clearRedoHistory(); // 有新操作时清空重做历史
+
+    for (EditObserver* observer : observers_) observer->actionApplied(record, true);
+}
+
+void Document::addObserver(EditObserver* observer)
+{
+    if (observer && std::find(observers_.begin(), observers_.end(), observer) == observers_.end()) {
+        observers_.push_back(observer);
+    }
+}
+
+void Document::removeObserver(EditObserver* observer)
+{
+    observers_.erase(std::remove(observers_.begin(), observers_.end(), observer), observers_.end());
+}
+
+void Document::notifyPageChanged()
+{
+    for (EditObserver* observer : observers_) observer->pageChanged(backgroundColor, pageSize, showGrid);
+}
+
+void Document::clearHistory()
+{
+    while (!undoStack_.empty()) undoStack_.pop();
+    while (!redoStack_.empty()) redoStack_.pop();
+    historyBytes_ = 0;
+}
+
+// 清空重做历史
+void Document::clearRedoHistory()
+{
+    while (!redoStack_.empty()) {
+        historyBytes_ -= estimateRecordBytes(redoStack_.top());
+        redoStack_.pop();
+    }
+}
+
+void Document::insertShape(int index, const QJsonObject& state, int& selectedIndex)
+{
+    auto s = createShapeFromJson(state);
+    if (!s) return;
+
+    if (index >= 0 && index <= static_cast<int>(shapes.size())) {
+        shapes.insert(index, std::move(s));
+        if (selectedIndex >= index) {
+            selectedIndex++;
+        }
+    } else {
+        shapes.push_back(std::move(s));
+    }
+}
+
+void Document::removeShape(int index, int& selectedIndex)
+{
+    if (index < 0 || index >= static_cast<int>(shapes.size())) return;
+
+    shapes.erase(index);
+    if (selectedIndex == index) {
+        selectedIndex = -1;
+    } else if (selectedIndex > index) {
+        selectedIndex--;
+    }
+}
+
+void Document::insertConnector(const ActionRecord& record, const QJsonObject& state, int& selectedConnectorIndex)
+{
+    const int count = static_cast<int>(shapes.size());
+    if (record.srcIndex < 0 || record.srcIndex >= count ||
+        record.dstIndex < 0 || record.dstIndex >= count) {
+        return;
+    }
+
+    Connector conn;
+    conn.src = shapes[record.srcIndex];
+    conn.dst = shapes[record.dstIndex];
+
+    // 恢复连接线属性
+    if (state.contains("color"))
+        conn.color = parseColor(state["color"].toString());
+    if (state.contains("width"))
+        conn.width = state["width"].toDouble(2.0);
+    if (state.contains("bidirectional"))
+        conn.bidirectional = state["bidirectional"].toBool();
+
+    int index = record.elementIndex;
+    if (index >= 0 && index <= static_cast<int>(connectors.size())) {
+        connectors.insert(connectors.begin() + index, conn);
+        if (selectedConnectorIndex >= index) {
+            selectedConnectorIndex++;
+        }
+    } else {
+        connectors.push_back(conn);
+    }
+}
+
+void Document::removeConnector(int index, int& selectedConnectorIndex)
+{
+    if (index < 0 || index >= static_cast<int>(connectors.size())) return;
+
+    connectors.erase(connectors.begin() + index);
+    if (selectedConnectorIndex == index) {
+        selectedConnectorIndex = -1;
+    } else if (selectedConnectorIndex > index) {
+        selectedConnectorIndex--;
+    }
+}
+
+void Document::moveShape(int from, int to, int& selectedIndex)
+{
+    if (from < 0 || from >= static_cast<int>(shapes.size())) return;
+
+    // 确保目标位置在有效范围内
+    int insertPos = qBound(0, to, static_cast<int>(shapes.size()) - 1);
+    shapes.move(from, insertPos);
+
+    // 更新选中索引
+    selectedIndex = insertPos;
+}
+
+void Document::applyState(const ActionRecord& record, const QJsonObject& state)
+{
+    const int index = record.elementIndex;
+
+    // 图形状态总是带有 "type" 字段，其余为连接线属性
+    if (state.contains("type") && index >= 0 && index < static_cast<int>(shapes.size())) {
+        auto s = createShape(shapes[index]->toJson()["type"].toString());
+        if (!s) return;
+
+        s->fromJson(state);
+        const Shape* oldShape = shapes[index];
+        shapes.replace(index, std::move(s));
+
+        // 更新所有指向这个图形的连接线
+        retargetConnectors(oldShape, shapes[index]);
+    } else if (index >= 0 && index < static_cast<int>(connectors.size())) {
+        Connector& conn = connectors[index];
+        if (state.contains("color"))
+            conn.color = parseColor(state["color"].toString());
+        if (state.contains("width"))
+            conn.width = state["width"].toDouble(2.0);
+        if (state.contains("bidirectional"))
+            conn.bidirectional = state["bidirectional"].toBool();
+
+        // 如果源和目标发生了变化
+        if (record.srcIndex >= 0 && record.srcIndex < static_cast<int>(shapes.size()))
+            conn.src = shapes[record.srcIndex];
+        if (record.dstIndex >= 0 && record.dstIndex < static_cast<int>(shapes.size()))
+            conn.dst = shapes[record.dstIndex];
+    }
+}
+
+// 按记录执行一次编辑：forward 为 true 时重做（应用 stateAfter），否则撤销（恢复 stateBefore）
+void Document::applyRecord(const ActionRecord& record, bool forward, int& selectedIndex, int& selectedConnectorIndex)
+{
+    switch (record.type) {
+        case ActionType::Add:
+            // 添加图形：撤销时删除，重做时重新插入
+            if (forward) insertShape(record.elementIndex, record.stateAfter, selectedIndex);
+            else         removeShape(record.elementIndex, selectedIndex);
+            break;
+
+        case ActionType::Delete:
+            // 删除图形：撤销时重新插入，重做时删除
+            if (forward) removeShape(record.elementIndex, selectedIndex);
+            else         insertShape(record.elementIndex, record.stateBefore, selectedIndex);
+            break;
+
+        case ActionType::Move:
+        case ActionType::Resize:
+        case ActionType::Property:
+            // 移动/调整大小/属性修改：恢复到对应的状态
+            applyState(record, forward ? record.stateAfter : record.stateBefore);
+            break;
+
+        case ActionType::ZOrder:
+            // 层级调整：在原位置和新位置之间移动图形
+            if (record.stateBefore.contains("index") && record.stateAfter.contains("index")) {
+                const int before = record.stateBefore["index"].toInt();
+                const int after = record.stateAfter["index"].toInt();
+                if (forward) moveShape(before, after, selectedIndex);
+                else         moveShape(after, before, selectedIndex);
+            }
+            break;
+
+        case ActionType::AddConn:
+            // 添加连接线：撤销时删除，重做时重新添加
+            if (forward) insertConnector(record, record.stateAfter, selectedConnectorIndex);
+            else         removeConnector(record.elementIndex, selectedConnectorIndex);
+            break;
+
+        case ActionType::DeleteConn:
+            // 删除连接线：撤销时重新添加，重做时删除
+            if (forward) removeConnector(record.elementIndex, selectedConnectorIndex);
+            else         insertConnector(record, record.stateBefore, selectedConnectorIndex);
+            break;
+    }
+}
+
+// 撤销操作
+bool Document::undo(int& selectedIndex, int& selectedConnectorIndex)
+{
+    if (undoStack_.empty()) return false;
+
+    TraceSpan span("Document::undo", "history");
+    isUndoRedoing_ = true;
+    ActionRecord record = undoStack_.top();
+    undoStack_.pop();
+    span.arg("action", static_cast<int>(record.type)).arg("index", record.elementIndex);
+
+    applyRecord(record, false, selectedIndex, selectedConnectorIndex);
+    for (EditObserver* observer : observers_) observer->actionApplied(record, false);
+
+    // 将动作放入重做栈
+    redoStack_.push(record);
+    isUndoRedoing_ = false;
+    return true;
+}
+
+// 重做操作
+bool Document::redo(int& selectedIndex, int& selectedConnectorIndex)
+{
+    if (redoStack_.empty()) return false;
+
+    TraceSpan span("Document::redo", "history");
+    isUndoRedoing_ = true;
+    ActionRecord record = redoStack_.top();
+    redoStack_.pop();
+    span.arg("action", static_cast<int>(record.type)).arg("index", record.elementIndex);
+
+    applyRecord(record, true, selectedIndex, selectedConnectorIndex);
+    for (EditObserver* observer : observers_) observer->actionApplied(record, true);
+
+    // 将动作放回撤销栈
+    undoStack_.push(record);
+    isUndoRedoing_ = false;
+    return true;
+}
+
+void Document::replayRecord(const ActionRecord& record, bool forward)
+{
+    int selectedIndex = -1;
+    int selectedConnectorIndex = -1;
+    isUndoRedoing_ = true;
+    applyRecord(record, forward, selectedIndex, selectedConnectorIndex);
+    isUndoRedoing_ = false;
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <QColor>
+#include <QJsonObject>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <stack>
+#include <vector>
+
+#include "Shape.hpp"
+#include "ShapeList.hpp"
+#include "Connector.hpp"
+#include "History.hpp"
+
+// 渲染/导出参数
+struct RenderOptions {
+    qreal  zoom = 1.0;      // 缩放倍数
+    QRectF region;          // 文档坐标中的渲染区域，为空时渲染整个页面
+    int    dpi = 96;        // 输出分辨率，96 表示 1:1 像素
+    bool   drawGrid = true; // 是否允许绘制网格（仍受 showGrid 控制）
+    qreal  pixelRatio = 1;  // PNG 的设备像素比：像素尺寸和记录的分辨率都乘以该倍数，打印尺寸不变
+};
+
+/* 细节层次（LOD）：缩小到图形在屏幕上只有几个像素时简化绘制
+   阈值均为屏幕像素，图形按外框长边、箭头按箭头长度计算 */
+struct LodOptions {
+    bool  enabled = false;      // 关闭时总是完整绘制（导出使用）
+    qreal textPixels = 24;      // 图形小于该尺寸时不绘制文字
+    qreal shapePixels = 8;      // 小于该尺寸时用矩形代替图形轮廓
+    qreal pointPixels = 2;      // 小于该尺寸时只画一个点
+    qreal arrowPixels = 4;      // 箭头小于该尺寸时不画箭头
+};
+
+// 保存参数
+struct SaveOptions {
+    int compressionLevel = 6;              // .fdz 的 zlib 压缩级别：0（不压缩）~ 9（最高），-1 为 zlib 默认
+    int compressionChunkSize = 1 << 20;    // .fdz 每个独立压缩块的原始字节数，块越多并行度越高
+};
+
+/* 不依赖任何窗口部件的流程图文档：保存图形、连接线、页面设置和撤销历史，
+   负责 JSON 读写，并可渲染到任意 QPainter。FlowView 只负责交互和视图变换
+
+   图形（ShapeList）和连接线（QVector）都是结构共享的，snapshot() 是 O(1) 的，
+   之后修改当前文档只复制被修改的部分。修改图形一律通过 editShape 进行。 */
+class Document
+{
+public:
+    Document() = default;
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
+    /* ---------- 序列化 ---------- */
+    // 保存到文件：.fdb 后缀为二进制格式，.fdz 为压缩格式，其余为 JSON
+    bool saveToFile(const QString& filename, const SaveOptions& options = SaveOptions()) const;
+    // 从文件加载（按文件头自动识别 JSON / 二进制 / 压缩格式），失败时保持原内容不变
+    bool loadFromFile(const QString& filename);
+    // 文件名是否对应二进制格式（.fdb）
+    static bool isBinaryFileName(const QString& filename);
+    // 文件名是否对应压缩格式（.fdz）
+    static bool isCompressedFileName(const QString& filename);
+    // 序列化为 JSON 根对象
+    QJsonObject toJson() const;
+    // 从 JSON 根对象加载（会先清空当前内容）
+    void fromJson(const QJsonObject& root);
+    // 清空所有图形和连接线
+    void clear();
+
+    // 文档快照：与当前文档共享全部图形和连接线（不含撤销历史），可交给其他线程只读使用
+    std::shared_ptr<const Document> snapshot() const;
+    // 取得可修改的图形：图形与快照共享时先复制，并让指向它的连接线指向副本
+    Shape* editShape(int index);
+
+    // 查找图形在列表中的索引，找不到返回 -1
+    int indexOf(const Shape* shape) const;
+
+    /* ---------- 撤销 / 重做 ---------- */
+    // 记录图形操作历史
+    void recordAction(ActionType type, int elementIndex, const QJsonObject& before, const QJsonObject& after);
+    // 记录连接线操作历史
+    void recordConnectorAction(ActionType type, int connIndex, int srcIndex, int dstIndex);
+    // 直接压入一条完整的操作记录（撤销/重做过程中忽略）
+    void pushAction(const ActionRecord& record);
+    // 清空撤销和重做历史（打开新文档时使用）
+    void clearHistory();
+    // 清空重做历史
+    void clearRedoHistory();
+
+    // 按记录重新执行（forward）或撤销一次编辑，不改动撤销/重做栈（回放日志用）
+    void replayRecord(const ActionRecord& record, bool forward);
+    // 注册/移除编辑观察者：提交、撤销和重做的每条记录都会通知（编辑日志、自动保存）
+    void addObserver(EditObserver* observer);
+    void removeObserver(EditObserver* observer);
+    // 直接修改 backgroundColor / pageSize / showGrid 之后调用，通知观察者
+    void notifyPageChanged();
+
+    // 撤销/重做，同时修正调用方的选中索引；没有可执行的操作时返回 false
+    bool undo(int& selectedIndex, int& selectedConnectorIndex);
+    bool redo(int& selectedIndex, int& selectedConnectorIndex);
+
+    bool canUndo() const { return !undoStack_.empty(); }
+    bool canRedo() const { return !redoStack_.empty(); }
+    // 撤销栈深度与撤销/重做历史占用内存的估算值（字节）
+    int undoDepth() const { return static_cast<int>(undoStack_.size()); }
+    qint64 historyBytes() const { return historyBytes_; }
+
+    // 页面矩形（文档坐标）
+    QRectF pageRect() const { return QRectF(QPointF(0, 0), QSizeF(pageSize)); }
+    // 无边界画布：页面大小为空时文档没有固定的页面，范围由图形决定
+    bool isUnbounded() const { return pageSize.isEmpty(); }
+    // 所有图形外框的并集，没有图形时为空
+    QRectF contentBounds() const;
+    // 文档范围：无边界画布为内容范围，否则为页面矩形
+    QRectF extent() const { return isUnbounded() ? contentBounds() : pageRect(); }
+
+    // 在文档坐标中绘制 area 范围内的网格
+    void drawGrid(QPainter& p, const QRectF& area) const;
+    // 绘制与 visible 相交的连接线（visible 为空时全部绘制），返回实际绘制数量
+    // exclude 不为空时跳过连在它上面的连接线（拖动中的图形另外绘制）
+    int drawConnectors(QPainter& p, const QRectF& visible = QRectF(), const LodOptions& lod = LodOptions(),
+                       const Shape* exclude = nullptr) const;
+    // 绘制与 visible 相交的图形，selectedIndex 对应的图形绘制选中框，返回实际绘制数量
+    // lod 开启时按 painter 当前的缩放简化小图形；exclude 不为空时跳过这个图形
+    int drawShapes(QPainter& p, int selectedIndex = -1, const QRectF& visible = QRectF(),
+                   const LodOptions& lod = LodOptions(), const Shape* exclude = nullptr) const;
+    // 分段绘制：只绘制下标在 [first, last) 中的连接线 / 图形，其余同上（分片渲染时按层级顺序逐段绘制）
+    int drawConnectorRange(QPainter& p, int first, int last, const QRectF& visible,
+                           const LodOptions& lod, const Shape* exclude = nullptr) const;
+    int drawShapeRange(QPainter& p, int first, int last, int selectedIndex, const QRectF& visible,
+                       const LodOptions& lod, const Shape* exclude = nullptr) const;
+    // 绘制 region 范围内的页面背景、网格、连接线和图形（painter 已设置好文档坐标变换）
+    void render(QPainter& p, const QRectF& region, bool withGrid = true) const;
+
+    // 导出为 PNG / SVG
+    bool exportToPng(const QString& filename, const RenderOptions& options = RenderOptions()) const;
+    bool exportToSvg(const QString& filename, const RenderOptions& options = RenderOptions()) const;
+
+    /* ---------- 文档数据 ---------- */
+    ShapeList shapes;                           // 所有图形元素
+    QVector<Connector> connectors;              // 所有连接线
+
+    QColor backgroundColor = QColor("#fdfdfd"); // 背景颜色
+    QSize  pageSize = QSize(2000, 2000);        // 页面大小，为空表示无边界画布
+    bool   showGrid = true;                     // 是否显示网格
+
+private:
+    // 根据导出参数计算实际渲染区域
+    QRectF exportRegion(const RenderOptions& options) const;
+    // 将记录中的状态应用到图形或连接线（撤销用 stateBefore，重做用 stateAfter）
+    void applyState(const ActionRecord& record, const QJsonObject& state);
+    // 在指定位置插入/删除图形、连接线，并修正选中索引
+    void insertShape(int index, const QJsonObject& state, int& selectedIndex);
+    void removeShape(int index, int& selectedIndex);
+    void insertConnector(const ActionRecord& record, const QJsonObject& state, int& selectedConnectorIndex);
+    void removeConnector(int index, int& selectedConnectorIndex);
+    // 调整层级：将 from 位置的图形移到 to
+    void moveShape(int from, int to, int& selectedIndex);
+    // 让指向 from 的连接线改为指向 to
+    void retargetConnectors(const Shape* from, const Shape* to);
+    // 执行记录中的编辑：forward 为 true 时应用 stateAfter，否则恢复 stateBefore
+    void applyRecord(const ActionRecord& record, bool forward, int& selectedIndex, int& selectedConnectorIndex);
+
+    // 操作历史记录
+    std::stack<ActionRecord> undoStack_;         // 撤销栈
+    std::stack<ActionRecord> redoStack_;         // 重做栈
+    bool isUndoRedoing_ = false;                 // 是否正在执行撤销/重做操作
+    qint64 historyBytes_ = 0;                    // 撤销/重做栈内存估算
+    std::vector<EditObserver*> observers_;       // 编辑观察者（不拥有）
+};
@@ -1,21 +1,24 @@
 #include "Ellipse.hpp"
 #include <QtMath>
+#include "ColorParse.hpp"
 
-void Ellipse::paint(QPainter& p, bool selected) const
+void Ellipse::paint(QPainter& p, bool selected, bool withText) const
 {
-    QPen pen(strokeColor, strokeWidth);
-    p.setPen(pen);
-    p.setBrush(fillColor);
+    p.setPen(style->pen);
+    p.setBrush(style->brush);
     p.drawEllipse(bounds);
     
     // 绘制文本
-    drawText(p);
+    if (withText) drawText(p);
 
-    if (selected) {
-        QPen pen(Qt::DashLine); pen.setColor(Qt::blue);
-        p.setPen(pen); p.setBrush(Qt::NoBrush);
-        p.drawEllipse(bounds.adjusted(-2, -2, 2, 2));
-    }
+    if (selected) paintSelection(p);
+}
+
+void Ellipse::paintSelection(QPainter& p) const
+{
+    QPen pen(Qt::DashLine); pen.setColor(Qt::blue);
+    p.setPen(pen); p.setBrush(Qt::NoBrush);
+    p.drawEllipse(bounds.adjusted(-2, -2, 2, 2));
 }
 
 bool Ellipse::hitTest(const QPointF& pt) const
@@ -63,12 +66,12 @@ QJsonObject Ellipse::toJson() const
         {"type","ellipse"},  // 修正这里的类型
         {"x",bounds.x()}, {"y",bounds.y()},
         {"w",bounds.width()}, {"h",bounds.height()},
-        {"fill",   fillColor.name(QColor::HexArgb)},
-        {"stroke", strokeColor.name(QColor::HexArgb)},
-        {"width",  strokeWidth},
+        {"fill",   fillColor().name(QColor::HexArgb)},
+        {"stroke", strokeColor().name(QColor::HexArgb)},
+        {"width",  strokeWidth()},
         {"text", text},
-        {"textColor", textColor.name(QColor::HexArgb)},
-        {"textSize", textSize}
+        {"textColor", textColor().name(QColor::HexArgb)},
+        {"textSize", textSize()}
     };
 }
 
@@ -76,10 +79,12 @@ void Ellipse::fromJson(const QJsonObject& o)
 {
     bounds = { o["x"].toDouble(), o["y"].toDouble(),
                o["w"].toDouble(), o["h"].toDouble() };
-    fillColor = QColor(o["fill"].toString("#ffffffff"));
-    strokeColor = QColor(o["stroke"].toString("#ff000000"));
-    strokeWidth = o["width"].toDouble(1.5);
+    Style st;
+    st.fillColor = parseColor(o["fill"].toString("#ffffffff"));
+    st.strokeColor = parseColor(o["stroke"].toString("#ff000000"));
+    st.strokeWidth = o["width"].toDouble(1.5);
+    st.textColor = parseColor(o["textColor"].toString("#ff000000"));
+    st.textSize = o["textSize"].toInt(10);
+    style = Style::intern(st);
     text = o["text"].toString();
-    textColor = QColor(o["textColor"].toString("#ff000000"));
-    textSize = o["textSize"].toInt(10);
 }
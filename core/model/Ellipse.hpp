@@ -5,8 +5,11 @@
 class Ellipse final : public Shape
 {
 public:
-    void paint(QPainter& p, bool selected) const override;
+    void paint(QPainter& p, bool selected, bool withText = true) const override;
+    void paintSelection(QPainter& p) const override;
     bool hitTest(const QPointF& pt) const override;
+    const char* typeName() const override { return "ellipse"; }
+    std::unique_ptr<Shape> clone() const override { return std::make_unique<Ellipse>(*this); }
     QPointF getConnectionPoint(const QPointF& ref) const override;
 
     QJsonObject toJson()  const override;
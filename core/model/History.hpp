@@ -0,0 +1,39 @@
+#pragma once
+#include <QColor>
+#include <QJsonObject>
+#include <QSize>
+
+// 操作类型枚举
+enum class ActionType {
+    Add,        // 添加图形
+    Delete,     // 删除图形
+    Move,       // 移动图形
+    Resize,     // 调整大小
+    Property,   // 修改属性
+    ZOrder,     // 调整层级
+    AddConn,    // 添加连接线
+    DeleteConn  // 删除连接线
+};
+
+// 历史操作记录结构
+struct ActionRecord {
+    ActionType type;                         // 操作类型
+    int elementIndex;                        // 操作元素的索引
+    QJsonObject stateBefore;                 // 操作前的状态
+    QJsonObject stateAfter;                  // 操作后的状态
+    
+    // 连接线相关信息
+    int srcIndex = -1;                       // 连接线起点索引
+    int dstIndex = -1;                       // 连接线终点索引
+};
+
+// 文档编辑的观察者（编辑日志、自动保存）：提交、撤销、重做的每条记录和页面设置修改都会通知
+class EditObserver
+{
+public:
+    virtual ~EditObserver() = default;
+    // 记录已应用到文档：forward 为 true 表示提交或重做，false 表示撤销
+    virtual void actionApplied(const ActionRecord& record, bool forward) = 0;
+    // 页面设置（背景色、页面大小、网格）已修改
+    virtual void pageChanged(const QColor& backgroundColor, const QSize& pageSize, bool showGrid) = 0;
+};
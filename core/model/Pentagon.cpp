@@ -2,8 +2,9 @@
 #include <QPainterPath>
 #include <QtMath>
 #include <limits>
+#include "ColorParse.hpp"
 
-void Pentagon::paint(QPainter& p, bool selected) const
+void Pentagon::paint(QPainter& p, bool selected, bool withText) const
 {
     // 创建五边形路径
     QPainterPath path;
@@ -27,22 +28,15 @@ void Pentagon::paint(QPainter& p, bool selected) const
     path.closeSubpath();
     
     // 绘制五边形
-    QPen pen(strokeColor, strokeWidth);
-    p.setPen(pen);
-    p.setBrush(fillColor);
+    p.setPen(style->pen);
+    p.setBrush(style->brush);
     p.drawPath(path);
     
     // 绘制文本
-    drawText(p);
+    if (withText) drawText(p);
 
     // 如果被选中，绘制虚线框
-    if (selected) {
-        QPen dashPen(Qt::DashLine);
-        dashPen.setColor(Qt::blue);
-        p.setPen(dashPen);
-        p.setBrush(Qt::NoBrush);
-        p.drawRect(bounds.adjusted(-2, -2, 2, 2));
-    }
+    if (selected) paintSelection(p);
 }
 
 bool Pentagon::hitTest(const QPointF& pt) const
@@ -144,12 +138,12 @@ QJsonObject Pentagon::toJson() const
         {"type", "pentagon"},
         {"x", bounds.x()}, {"y", bounds.y()},
         {"w", bounds.width()}, {"h", bounds.height()},
-        {"fill", fillColor.name(QColor::HexArgb)},
-        {"stroke", strokeColor.name(QColor::HexArgb)},
-        {"width", strokeWidth},
+        {"fill", fillColor().name(QColor::HexArgb)},
+        {"stroke", strokeColor().name(QColor::HexArgb)},
+        {"width", strokeWidth()},
         {"text", text},
-        {"textColor", textColor.name(QColor::HexArgb)},
-        {"textSize", textSize}
+        {"textColor", textColor().name(QColor::HexArgb)},
+        {"textSize", textSize()}
     };
 }
 
@@ -157,10 +151,12 @@ void Pentagon::fromJson(const QJsonObject& o)
 {
     bounds = { o["x"].toDouble(), o["y"].toDouble(),
                o["w"].toDouble(), o["h"].toDouble() };
-    fillColor = QColor(o["fill"].toString("#ffffffff"));
-    strokeColor = QColor(o["stroke"].toString("#ff000000"));
-    strokeWidth = o["width"].toDouble(1.5);
+    Style st;
+    st.fillColor = parseColor(o["fill"].toString("#ffffffff"));
+    st.strokeColor = parseColor(o["stroke"].toString("#ff000000"));
+    st.strokeWidth = o["width"].toDouble(1.5);
+    st.textColor = parseColor(o["textColor"].toString("#ff000000"));
+    st.textSize = o["textSize"].toInt(10);
+    style = Style::intern(st);
     text = o["text"].toString();
-    textColor = QColor(o["textColor"].toString("#ff000000"));
-    textSize = o["textSize"].toInt(10);
 } 
\ No newline at end of file
@@ -4,8 +4,10 @@
 class Rect final : public Shape
 {
 public:
-    void paint(QPainter& p, bool selected) const override;
+    void paint(QPainter& p, bool selected, bool withText = true) const override;
     bool hitTest(const QPointF& pt) const override;
+    const char* typeName() const override { return "rect"; }
+    std::unique_ptr<Shape> clone() const override { return std::make_unique<Rect>(*this); }
     QPointF getConnectionPoint(const QPointF& ref) const override;
 
     QJsonObject toJson() const override;        //  
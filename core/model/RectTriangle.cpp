@@ -1,50 +1,54 @@
 #include "RectTriangle.hpp"
 #include <QPainterPath>
 #include <cmath>
+#include "ColorParse.hpp"
 
 // 在Windows平台上定义M_PI（如果尚未定义）
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-void RectTriangle::paint(QPainter& p, bool selected) const
+QPainterPath RectTriangle::outline() const
 {
-    // 绘制直角三角形（左下角为直角）
-    QPen pen(strokeColor, strokeWidth);
-    p.setPen(pen);
-    p.setBrush(fillColor);
-    
-    // 创建路径
-    QPainterPath path;
-    
     // 三角形三个点：左下角、右下角、左上角
+    QPainterPath path;
     path.moveTo(bounds.bottomLeft());
     path.lineTo(bounds.bottomRight());
     path.lineTo(bounds.topLeft());
     path.closeSubpath();
-    
-    p.drawPath(path);
+    return path;
+}
+
+void RectTriangle::paint(QPainter& p, bool selected, bool withText) const
+{
+    // 绘制直角三角形（左下角为直角）
+    p.setPen(style->pen);
+    p.setBrush(style->brush);
+    p.drawPath(outline());
     
     // 绘制文本
-    drawText(p);
+    if (withText) drawText(p);
     
     // 如果被选中，绘制虚线框，适应形状
-    if (selected) {
-        QPen dashPen(Qt::DashLine);
-        dashPen.setColor(Qt::blue);
-        p.setPen(dashPen);
-        p.setBrush(Qt::NoBrush);
-        
-        // 使用稍微放大的路径绘制选中框
-        QPainterPath selectionPath = path;
-        QTransform transform;
-        transform.translate(bounds.center().x(), bounds.center().y());
-        transform.scale(1.04, 1.04); // 比实际形状稍大
-        transform.translate(-bounds.center().x(), -bounds.center().y());
-        selectionPath = transform.map(selectionPath);
-        
-        p.drawPath(selectionPath);
-    }
+    if (selected) paintSelection(p);
+}
+
+void RectTriangle::paintSelection(QPainter& p) const
+{
+    QPen dashPen(Qt::DashLine);
+    dashPen.setColor(Qt::blue);
+    p.setPen(dashPen);
+    p.setBrush(Qt::NoBrush);
+    
+    // 使用稍微放大的路径绘制选中框
+    QPainterPath selectionPath = outline();
+    QTransform transform;
+    transform.translate(bounds.center().x(), bounds.center().y());
+    transform.scale(1.04, 1.04); // 比实际形状稍大
+    transform.translate(-bounds.center().x(), -bounds.center().y());
+    selectionPath = transform.map(selectionPath);
+    
+    p.drawPath(selectionPath);
 }
 
 bool RectTriangle::hitTest(const QPointF& pt) const
@@ -129,12 +133,12 @@ QJsonObject RectTriangle::toJson() const
         {"type", "recttriangle"},
         {"x", bounds.x()}, {"y", bounds.y()},
         {"w", bounds.width()}, {"h", bounds.height()},
-        {"fill", fillColor.name(QColor::HexArgb)},
-        {"stroke", strokeColor.name(QColor::HexArgb)},
-        {"width", strokeWidth},
+        {"fill", fillColor().name(QColor::HexArgb)},
+        {"stroke", strokeColor().name(QColor::HexArgb)},
+        {"width", strokeWidth()},
         {"text", text},
-        {"textColor", textColor.name(QColor::HexArgb)},
-        {"textSize", textSize}
+        {"textColor", textColor().name(QColor::HexArgb)},
+        {"textSize", textSize()}
     };
 }
 
@@ -142,10 +146,12 @@ void RectTriangle::fromJson(const QJsonObject& o)
 {
     bounds = { o["x"].toDouble(), o["y"].toDouble(),
                o["w"].toDouble(), o["h"].toDouble() };
-    fillColor = QColor(o["fill"].toString("#ffffffff"));
-    strokeColor = QColor(o["stroke"].toString("#ff000000"));
-    strokeWidth = o["width"].toDouble(1.5);
+    Style st;
+    st.fillColor = parseColor(o["fill"].toString("#ffffffff"));
+    st.strokeColor = parseColor(o["stroke"].toString("#ff000000"));
+    st.strokeWidth = o["width"].toDouble(1.5);
+    st.textColor = parseColor(o["textColor"].toString("#ff000000"));
+    st.textSize = o["textSize"].toInt(10);
+    style = Style::intern(st);
     text = o["text"].toString();
-    textColor = QColor(o["textColor"].toString("#ff000000"));
-    textSize = o["textSize"].toInt(10);
 } 
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include "Shape.hpp"
+#include <QPainterPath>
+
+class RectTriangle : public Shape
+{
+public:
+    void paint(QPainter& p, bool selected, bool withText = true) const override;
+    void paintSelection(QPainter& p) const override;
+    bool hitTest(const QPointF& pt) const override;
+    const char* typeName() const override { return "recttriangle"; }
+    std::unique_ptr<Shape> clone() const override { return std::make_unique<RectTriangle>(*this); }
+    QPointF getConnectionPoint(const QPointF& ref) const override;
+    QJsonObject toJson() const override;
+    void fromJson(const QJsonObject& o) override;
+
+private:
+    QPainterPath outline() const;   // 图形的轮廓路径
+};
@@ -6,8 +6,10 @@ class RoundedRect final : public Shape
 public:
     RoundedRect() : cornerRadius_(10) {}  // 默认圆角半径为10
     
-    void paint(QPainter& p, bool selected) const override;
+    void paint(QPainter& p, bool selected, bool withText = true) const override;
     bool hitTest(const QPointF& pt) const override;
+    const char* typeName() const override { return "roundedrect"; }
+    std::unique_ptr<Shape> clone() const override { return std::make_unique<RoundedRect>(*this); }
     QPointF getConnectionPoint(const QPointF& ref) const override;
 
     QJsonObject toJson() const override;
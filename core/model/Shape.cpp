@@ -0,0 +1,51 @@
+#include "Shape.hpp"
+
+#include <QFontMetricsF>
+#include <QPaintDevice>
+#include <cmath>
+
+void Shape::paintSelection(QPainter& p) const
+{
+    // 默认为略大于外框的虚线矩形
+    QPen dashPen(Qt::DashLine);
+    dashPen.setColor(Qt::blue);
+    p.setPen(dashPen);
+    p.setBrush(Qt::NoBrush);
+    p.drawRect(bounds.adjusted(-2, -2, 2, 2));
+}
+
+void Shape::drawText(QPainter& p) const
+{
+    if (text.isEmpty()) return;
+
+    p.setFont(style->font);
+    p.setPen(style->textPen);
+    const QFont& font = p.font();   // 已按绘图设备的分辨率解析
+    const int dpi = p.device() ? p.device()->logicalDpiY() : 0;
+
+    TextLayout& t = textLayout_;
+    if (t.text != text || t.textSize != style->textSize || t.size != bounds.size() || t.dpi != dpi) {
+        // 按 QPainter::drawText(rect, Qt::AlignCenter, text) 的方式排版：不自动换行，各行水平居中
+        const QSizeF natural = QFontMetricsF(font).size(0, text);
+        QString lines = text;
+        lines.replace(QLatin1Char('\n'), QChar::LineSeparator);
+
+        t.text = text;
+        t.textSize = style->textSize;
+        t.size = bounds.size();
+        t.dpi = dpi;
+        t.staticText.setText(lines);
+        t.staticText.setTextFormat(Qt::PlainText);
+        t.staticText.setTextOption(QTextOption(Qt::AlignHCenter));
+        t.staticText.setTextWidth(std::ceil(natural.width()));
+        t.staticText.prepare(QTransform(), font);
+        t.offset = QPointF((bounds.width() - t.staticText.textWidth()) / 2, (bounds.height() - natural.height()) / 2);
+        t.fits = natural.width() <= bounds.width() && natural.height() <= bounds.height();
+    }
+
+    if (t.fits) {
+        p.drawStaticText(bounds.topLeft() + t.offset, t.staticText);
+    } else {
+        p.drawText(bounds, Qt::AlignCenter, text);   // 超出外框的文本需要裁剪，走原来的路径
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <QPainter>
+#include <QRectF>
+#include <QJsonObject>
+#include <QStaticText>
+#include <QString>
+#include <memory>
+
+#include "Style.hpp"
+
+/* 基类：所有可绘制元素的公共接口 */
+class Shape
+{
+public:
+
+    virtual ~Shape() = default;
+
+    // 绘制函数，withText 为 false 时不绘制文字（缩小到文字无法辨认时）
+    virtual void paint(QPainter& p, bool selected, bool withText = true) const = 0;
+    // 绘制选中框（画布在内容缓存之上的覆盖层中单独调用，选中状态改变时不必重绘图形）
+    virtual void paintSelection(QPainter& p) const;
+    // 碰撞测试，判断 pt 是否在形状内
+    virtual bool hitTest(const QPointF& pt) const = 0;
+    // 类型名，与 JSON 中的 "type" 字段一致
+    virtual const char* typeName() const = 0;
+    // 复制图形（文档快照与当前文档共享图形，修改共享的图形前先复制）
+    virtual std::unique_ptr<Shape> clone() const = 0;
+   
+    // 序列化函数
+    virtual QJsonObject toJson() const = 0;
+    virtual void fromJson(const QJsonObject&) = 0;
+    
+    // 获取连接点方法
+    virtual QPointF getConnectionPoint(const QPointF& ref) const {
+        // 默认实现：使用矩形边框的中点
+        const QRectF& b = bounds;
+        QPointF mids[4] = {
+            {(b.left() + b.right()) / 2, b.top()},
+            {b.right(), (b.top() + b.bottom()) / 2},
+            {(b.left() + b.right()) / 2, b.bottom()},
+            {b.left(), (b.top() + b.bottom()) / 2}
+        };
+        QPointF best = mids[0];
+        qreal bestDist = QLineF(ref, best).length();
+        for (int i = 1; i < 4; ++i) {
+            qreal d = QLineF(ref, mids[i]).length();
+            if (d < bestDist) { best = mids[i]; bestDist = d; }
+        }
+        return best;
+    }
+
+    QRectF bounds;   // 外围框，用于移动和选中
+    const Style* style = Style::defaultStyle();   // 共享的样式，修改时换成另一个样式
+
+    const QColor& fillColor() const { return style->fillColor; }
+    const QColor& strokeColor() const { return style->strokeColor; }
+    qreal strokeWidth() const { return style->strokeWidth; }
+    const QColor& textColor() const { return style->textColor; }
+    int textSize() const { return style->textSize; }
+
+    void setFillColor(const QColor& c) { Style s = *style; s.fillColor = c; style = Style::intern(s); }
+    void setStrokeColor(const QColor& c) { Style s = *style; s.strokeColor = c; style = Style::intern(s); }
+    void setStrokeWidth(qreal w) { Style s = *style; s.strokeWidth = w; style = Style::intern(s); }
+    void setTextColor(const QColor& c) { Style s = *style; s.textColor = c; style = Style::intern(s); }
+    void setTextSize(int size) { Style s = *style; s.textSize = size; style = Style::intern(s); }
+
+    // 添加文本相关属性
+    QString text;
+
+    // 绘制文本的辅助函数
+    void drawText(QPainter& p) const;
+
+protected:
+    /* 文本排版缓存：文本、字号、外框大小或设备分辨率改变时才重新排版，
+       其余时候绘制文本只是按缓存的字形位置输出。移动图形不需要重新排版。
+       缓存在绘制时填写，同一个图形不能同时在多个线程中绘制 */
+    struct TextLayout {
+        QString     text;
+        int         textSize = 0;
+        QSizeF      size;               // 排版时外框的大小
+        int         dpi = 0;            // 排版时绘图设备的分辨率
+        QStaticText staticText;
+        QPointF     offset;             // 相对外框左上角的位置
+        bool        fits = false;       // 文本在外框内，不需要裁剪
+    };
+    mutable TextLayout textLayout_;
+};
@@ -0,0 +1,35 @@
+#include "ShapeFactory.hpp"
+#include "Rect.hpp"
+#include "Ellipse.hpp"
+#include "Diamond.hpp"
+#include "Triangle.hpp"
+#include "Pentagon.hpp"
+#include "Hexagon.hpp"
+#include "Octagon.hpp"
+#include "RoundedRect.hpp"
+#include "Capsule.hpp"
+#include "RectTriangle.hpp"
+
+std::unique_ptr<Shape> createShape(const QString& type)
+{
+    if (type == "rect")              return std::make_unique<Rect>();
+    else if (type == "ellipse")      return std::make_unique<Ellipse>();
+    else if (type == "diamond")      return std::make_unique<Diamond>();
+    else if (type == "triangle")     return std::make_unique<Triangle>();
+    else if (type == "pentagon")     return std::make_unique<Pentagon>();
+    else if (type == "hexagon")      return std::make_unique<Hexagon>();
+    else if (type == "octagon")      return std::make_unique<Octagon>();
+    else if (type == "roundedrect")  return std::make_unique<RoundedRect>();
+    else if (type == "capsule")      return std::make_unique<Capsule>();
+    else if (type == "recttriangle") return std::make_unique<RectTriangle>();
+    return nullptr;
+}
+
+std::unique_ptr<Shape> createShapeFromJson(const QJsonObject& obj)
+{
+    auto shape = createShape(obj["type"].toString());
+    if (shape) {
+        shape->fromJson(obj);
+    }
+    return shape;
+}
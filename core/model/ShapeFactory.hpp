@@ -0,0 +1,10 @@
+#pragma once
+#include <memory>
+#include <QString>
+#include "Shape.hpp"
+
+// 根据类型字符串创建对应的图形对象（与 toJson 中的 "type" 字段一致），未知类型返回空指针
+std::unique_ptr<Shape> createShape(const QString& type);
+
+// 根据 JSON 对象创建并反序列化图形，未知类型返回空指针
+std::unique_ptr<Shape> createShapeFromJson(const QJsonObject& obj);
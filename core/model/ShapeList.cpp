@@ -0,0 +1,207 @@
+#include "ShapeList.hpp"
+
+#include <algorithm>
+
+const Shape* ShapeList::const_iterator::operator*() const
+{
+    return spine_->chunks[chunk_]->items[item_].get();
+}
+
+ShapeList::const_iterator& ShapeList::const_iterator::operator++()
+{
+    if (++item_ >= static_cast<int>(spine_->chunks[chunk_]->items.size())) {
+        ++chunk_;
+        item_ = 0;
+    }
+    return *this;
+}
+
+ShapeList::ShapeList(std::vector<std::unique_ptr<Shape>>&& shapes)
+{
+    *this = std::move(shapes);
+}
+
+ShapeList& ShapeList::operator=(std::vector<std::unique_ptr<Shape>>&& shapes)
+{
+    clear();
+    reserve(static_cast<int>(shapes.size()));
+    for (auto& shape : shapes) {
+        push_back(std::move(shape));
+    }
+    shapes.clear();
+    return *this;
+}
+
+int ShapeList::size() const
+{
+    return spine_ ? spine_->size : 0;
+}
+
+const Shape* ShapeList::operator[](int index) const
+{
+    const int chunk = chunkOf(index);
+    return spine_->chunks[chunk]->items[index - spine_->starts[chunk]].get();
+}
+
+int ShapeList::indexOf(const Shape* shape) const
+{
+    if (!shape || !spine_) return -1;
+    for (size_t c = 0; c < spine_->chunks.size(); ++c) {
+        const auto& items = spine_->chunks[c]->items;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (items[i].get() == shape) return spine_->starts[c] + static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+ShapeList::const_iterator ShapeList::begin() const
+{
+    return const_iterator(spine_.get(), 0);
+}
+
+ShapeList::const_iterator ShapeList::end() const
+{
+    return const_iterator(spine_.get(), spine_ ? static_cast<int>(spine_->chunks.size()) : 0);
+}
+
+ShapeList::const_iterator ShapeList::iteratorAt(int index) const
+{
+    if (index >= size()) return end();
+    const int chunk = chunkOf(index);
+    const_iterator it(spine_.get(), chunk);
+    it.item_ = index - spine_->starts[chunk];
+    return it;
+}
+
+ShapeList::Spine& ShapeList::mutableSpine()
+{
+    if (!spine_) {
+        spine_ = std::make_shared<Spine>();
+    } else if (spine_.use_count() > 1) {
+        spine_ = std::make_shared<Spine>(*spine_);   // 只复制块指针
+    }
+    return *spine_;
+}
+
+ShapeList::Chunk& ShapeList::mutableChunk(Spine& spine, int chunk)
+{
+    std::shared_ptr<Chunk>& c = spine.chunks[chunk];
+    if (c.use_count() > 1) {
+        c = std::make_shared<Chunk>(*c);   // 只复制图形指针
+    }
+    return *c;
+}
+
+int ShapeList::chunkOf(int index) const
+{
+    const std::vector<int>& starts = spine_->starts;
+    return static_cast<int>(std::upper_bound(starts.begin(), starts.end(), index) - starts.begin()) - 1;
+}
+
+void ShapeList::updateStarts(Spine& spine, int chunk)
+{
+    spine.starts.resize(spine.chunks.size());
+    int start = chunk > 0 ? spine.starts[chunk - 1] + static_cast<int>(spine.chunks[chunk - 1]->items.size()) : 0;
+    for (size_t c = chunk; c < spine.chunks.size(); ++c) {
+        spine.starts[c] = start;
+        start += static_cast<int>(spine.chunks[c]->items.size());
+    }
+    spine.size = start;
+}
+
+Shape* ShapeList::detach(int index)
+{
+    Spine& spine = mutableSpine();
+    const int chunk = chunkOf(index);
+    std::shared_ptr<Shape>& item = mutableChunk(spine, chunk).items[index - spine.starts[chunk]];
+    if (item.use_count() > 1) {
+        item = std::shared_ptr<Shape>(item->clone());
+    }
+    return item.get();
+}
+
+void ShapeList::reserve(int count)
+{
+    mutableSpine().chunks.reserve(count / ChunkSize + 1);
+}
+
+void ShapeList::push_back(std::unique_ptr<Shape> shape)
+{
+    insertItem(size(), std::shared_ptr<Shape>(std::move(shape)));
+}
+
+void ShapeList::insert(int index, std::unique_ptr<Shape> shape)
+{
+    insertItem(index, std::shared_ptr<Shape>(std::move(shape)));
+}
+
+void ShapeList::erase(int index)
+{
+    takeItem(index);
+}
+
+void ShapeList::replace(int index, std::unique_ptr<Shape> shape)
+{
+    Spine& spine = mutableSpine();
+    const int chunk = chunkOf(index);
+    mutableChunk(spine, chunk).items[index - spine.starts[chunk]] = std::shared_ptr<Shape>(std::move(shape));
+}
+
+void ShapeList::move(int from, int to)
+{
+    std::shared_ptr<Shape> item = takeItem(from);
+    insertItem(qBound(0, to, size()), std::move(item));
+}
+
+void ShapeList::insertItem(int index, std::shared_ptr<Shape> item)
+{
+    Spine& spine = mutableSpine();
+
+    // 在末尾追加且最后一块已满时开始新块，顺序加载的文档各块都是满的
+    if (spine.chunks.empty() ||
+        (index == spine.size && static_cast<int>(spine.chunks.back()->items.size()) >= ChunkSize)) {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->items.reserve(ChunkSize);
+        chunk->items.push_back(std::move(item));
+        spine.chunks.push_back(std::move(chunk));
+        updateStarts(spine, static_cast<int>(spine.chunks.size()) - 1);
+        return;
+    }
+
+    const int c = chunkOf(index);
+    Chunk& chunk = mutableChunk(spine, c);
+    chunk.items.insert(chunk.items.begin() + (index - spine.starts[c]), std::move(item));
+
+    // 块过大时对半拆分，保持路径复制的代价有上限
+    if (static_cast<int>(chunk.items.size()) > 2 * ChunkSize) {
+        auto tail = std::make_shared<Chunk>();
+        tail->items.assign(std::make_move_iterator(chunk.items.begin() + ChunkSize),
+                           std::make_move_iterator(chunk.items.end()));
+        chunk.items.resize(ChunkSize);
+        spine.chunks.insert(spine.chunks.begin() + c + 1, std::move(tail));
+    }
+    updateStarts(spine, c);
+}
+
+std::shared_ptr<Shape> ShapeList::takeItem(int index)
+{
+    Spine& spine = mutableSpine();
+    const int c = chunkOf(index);
+    Chunk& chunk = mutableChunk(spine, c);
+    auto it = chunk.items.begin() + (index - spine.starts[c]);
+    std::shared_ptr<Shape> item = std::move(*it);
+    chunk.items.erase(it);
+
+    if (chunk.items.empty()) {
+        spine.chunks.erase(spine.chunks.begin() + c);
+    } else if (c + 1 < static_cast<int>(spine.chunks.size()) &&
+               chunk.items.size() + spine.chunks[c + 1]->items.size() <= static_cast<size_t>(ChunkSize)) {
+        // 与后一块合并，避免反复删除后留下大量很小的块
+        const auto& next = spine.chunks[c + 1]->items;
+        chunk.items.insert(chunk.items.end(), next.begin(), next.end());
+        spine.chunks.erase(spine.chunks.begin() + c + 1);
+    }
+    updateStarts(spine, qMax(0, qMin(c, static_cast<int>(spine.chunks.size()) - 1)));
+    return item;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "Shape.hpp"
+
+/* 结构共享的图形列表（持久化数据结构）
+
+   图形按顺序分块存放（每块最多 2 * ChunkSize 个），列表只持有块表的共享指针。
+   复制列表（文档快照）是 O(1) 的：两份列表共享块表、块和图形对象。
+   修改时只复制从块表到被修改图形的路径 —— 块表（块数个指针）、所在的块（不超过
+   2 * ChunkSize 个指针）和图形本身，其余部分仍与快照共享。
+   与 Qt 的隐式共享一样，引用计数为 1 即表示独占，没有快照时所有修改都是原地进行的。
+
+   只读访问返回 const Shape*；需要修改图形时通过 detach（或 Document::editShape）取得
+   独占的副本。快照可以交给其他线程只读使用。 */
+class ShapeList
+{
+    struct Chunk;
+    struct Spine;
+
+public:
+    static constexpr int ChunkSize = 64;
+
+    // 顺序遍历（比逐个下标访问快，下标访问需要先查找所在的块）
+    class const_iterator
+    {
+    public:
+        const Shape* operator*() const;
+        const_iterator& operator++();
+        bool operator==(const const_iterator& other) const { return chunk_ == other.chunk_ && item_ == other.item_; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class ShapeList;
+        const_iterator(const Spine* spine, int chunk) : spine_(spine), chunk_(chunk) {}
+
+        const Spine* spine_ = nullptr;
+        int          chunk_ = 0;
+        int          item_ = 0;
+    };
+
+    ShapeList() = default;
+    ShapeList(std::vector<std::unique_ptr<Shape>>&& shapes);
+    ShapeList& operator=(std::vector<std::unique_ptr<Shape>>&& shapes);
+
+    int size() const;
+    bool empty() const { return size() == 0; }
+    const Shape* operator[](int index) const;
+    const Shape* back() const { return (*this)[size() - 1]; }
+    // 查找图形的索引，找不到返回 -1
+    int indexOf(const Shape* shape) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    // 从 index 开始遍历（index 不小于 size() 时返回 end()）
+    const_iterator iteratorAt(int index) const;
+
+    // 取得可修改的图形：与快照共享时先复制路径上的节点，返回的指针可能与 (*this)[index] 不同
+    Shape* detach(int index);
+
+    void reserve(int count);
+    void push_back(std::unique_ptr<Shape> shape);
+    void insert(int index, std::unique_ptr<Shape> shape);
+    void erase(int index);
+    // 用新图形替换 index 处的图形
+    void replace(int index, std::unique_ptr<Shape> shape);
+    // 调整层级：把 from 处的图形移到 to（图形对象不变）
+    void move(int from, int to);
+    void clear() { spine_.reset(); }
+
+private:
+    struct Chunk {
+        std::vector<std::shared_ptr<Shape>> items;
+    };
+    struct Spine {
+        std::vector<std::shared_ptr<Chunk>> chunks;   // 不含空块
+        std::vector<int>                    starts;   // 每块第一个图形的索引
+        int                                 size = 0;
+    };
+
+    // 取得独占的块表 / 块（与快照共享时先复制）
+    Spine& mutableSpine();
+    Chunk& mutableChunk(Spine& spine, int chunk);
+    // index 所在的块；index == size 时为最后一块
+    int chunkOf(int index) const;
+    // 从 chunk 开始重新计算 starts
+    void updateStarts(Spine& spine, int chunk);
+
+    void insertItem(int index, std::shared_ptr<Shape> item);
+    std::shared_ptr<Shape> takeItem(int index);
+
+    std::shared_ptr<Spine> spine_;
+};
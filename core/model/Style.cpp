@@ -0,0 +1,78 @@
+#include "Style.hpp"
+
+#include <QHash>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+uint styleHash(const Style& s)
+{
+    uint h = qHash(s.fillColor.rgba());
+    h = h * 31 + qHash(s.strokeColor.rgba());
+    h = h * 31 + qHash(s.strokeWidth);
+    h = h * 31 + qHash(s.textColor.rgba());
+    h = h * 31 + qHash(s.textSize);
+    return h;
+}
+
+struct StyleTable {
+    std::mutex                                 mutex;
+    QMultiHash<uint, const Style*>             index;
+    std::vector<std::unique_ptr<const Style>>  styles;
+};
+
+StyleTable& table()
+{
+    static StyleTable t;
+    return t;
+}
+
+} // namespace
+
+bool Style::sameAttributes(const Style& other) const
+{
+    return fillColor.rgba() == other.fillColor.rgba()
+        && strokeColor.rgba() == other.strokeColor.rgba()
+        && strokeWidth == other.strokeWidth
+        && textColor.rgba() == other.textColor.rgba()
+        && textSize == other.textSize;
+}
+
+const Style* Style::intern(const Style& attrs)
+{
+    // 加载时相邻的图形通常样式相同，先查本线程上一次的结果，避免争用锁
+    thread_local const Style* last = nullptr;
+    if (last && last->sameAttributes(attrs)) return last;
+
+    StyleTable& t = table();
+    const uint hash = styleHash(attrs);
+    std::lock_guard<std::mutex> lock(t.mutex);
+
+    for (auto it = t.index.constFind(hash); it != t.index.constEnd() && it.key() == hash; ++it) {
+        if (it.value()->sameAttributes(attrs)) return last = it.value();
+    }
+
+    auto style = std::make_unique<Style>();
+    style->fillColor = attrs.fillColor;
+    style->strokeColor = attrs.strokeColor;
+    style->strokeWidth = attrs.strokeWidth;
+    style->textColor = attrs.textColor;
+    style->textSize = attrs.textSize;
+    style->pen = QPen(attrs.strokeColor, attrs.strokeWidth);
+    style->brush = QBrush(attrs.fillColor);
+    style->font.setPointSize(attrs.textSize);
+    style->textPen = QPen(attrs.textColor);
+
+    last = style.get();
+    t.index.insert(hash, last);
+    t.styles.push_back(std::move(style));
+    return last;
+}
+
+const Style* Style::defaultStyle()
+{
+    static const Style* style = intern(Style());
+    return style;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <QBrush>
+#include <QColor>
+#include <QFont>
+#include <QPen>
+
+/* 图形样式（享元）
+
+   填充色、描边色、描边宽度、文字颜色和字号组成一个样式。相同的样式在全局样式表中
+   只保存一份，图形只持有指向它的指针：每个图形少存四十多字节，绘制时直接使用预先
+   构建好的 QPen / QBrush / QFont，不必每次重新构造。相邻图形样式相同时它们共享同一个
+   QPen，QPainter::setPen 比较时只比较数据指针，不会产生多余的状态切换。
+
+   样式创建后不再修改，也不会释放（不同样式的数量很少）；修改图形的样式是换成另一个
+   样式，文档快照和工作线程中的图形不受影响。intern 可以在任意线程中调用。 */
+class Style
+{
+public:
+    QColor fillColor = Qt::white;
+    QColor strokeColor = Qt::black;
+    qreal  strokeWidth = 2.0;
+    QColor textColor = Qt::black;
+    int    textSize = 10;
+
+    // 由以上属性构建的绘制对象（intern 时填写）
+    QPen   pen;
+    QBrush brush;
+    QFont  font;
+    QPen   textPen;
+
+    // 只比较属性（颜色按 ARGB 比较）
+    bool sameAttributes(const Style& other) const;
+
+    // 取得与 attrs 属性相同的共享样式，不存在时创建
+    static const Style* intern(const Style& attrs);
+    // 默认样式
+    static const Style* defaultStyle();
+};
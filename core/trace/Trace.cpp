@@ -0,0 +1,177 @@
+#include "Trace.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+/* 记录状态：输出文件和线程编号由 mutex 保护
+   时钟在进程中只启动一次、之后只读，各线程可以不加锁地读取；每次开始记录只更新起点 */
+struct TraceState {
+    TraceState() { clock.start(); }
+
+    std::mutex    mutex;
+    QFile         file;
+    QElapsedTimer clock;
+    std::atomic<qint64> originNs{0};   // 本次记录开始时 clock 的读数
+    bool          firstEvent = true;
+    int           nextThreadId = 1;
+};
+
+TraceState& state()
+{
+    static TraceState s;
+    return s;
+}
+
+// 为每个线程分配一个从 1 开始的小编号，便于在查看器中区分
+int currentThreadId()
+{
+    thread_local int id = 0;
+    if (id == 0) {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        id = state().nextThreadId++;
+    }
+    return id;
+}
+
+// 在持有锁的情况下追加一条事件
+void appendEvent(TraceState& s, const QJsonObject& event)
+{
+    if (!s.file.isOpen()) return;
+    if (!s.firstEvent) s.file.write(",\n");
+    s.file.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    s.firstEvent = false;
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::enabled_(false);
+
+bool Tracer::start(const QString& filename)
+{
+    stop();
+
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.file.setFileName(filename);
+    if (!s.file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    s.file.write("[\n");
+    s.firstEvent = true;
+    s.originNs.store(s.clock.nsecsElapsed(), std::memory_order_relaxed);
+
+    // 进程名元数据
+    QJsonObject meta;
+    meta["name"] = "process_name";
+    meta["ph"] = "M";
+    meta["pid"] = QCoreApplication::applicationPid();
+    meta["tid"] = 0;
+    QJsonObject args;
+    args["name"] = QCoreApplication::applicationName();
+    meta["args"] = args;
+    appendEvent(s, meta);
+
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void Tracer::stop()
+{
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    enabled_.store(false, std::memory_order_relaxed);
+    if (s.file.isOpen()) {
+        s.file.write("\n]\n");
+        s.file.close();
+    }
+}
+
+bool Tracer::startFromEnvironment()
+{
+    const QString filename = qEnvironmentVariable("FLOWDRAW_TRACE");
+    if (filename.isEmpty()) return false;
+    return start(filename);
+}
+
+QString Tracer::currentFile()
+{
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.file.isOpen() ? s.file.fileName() : QString();
+}
+
+double Tracer::nowUs()
+{
+    const TraceState& s = state();
+    return (s.clock.nsecsElapsed() - s.originNs.load(std::memory_order_relaxed)) / 1000.0;
+}
+
+void Tracer::writeComplete(const char* name, const char* category,
+                           double startUs, double durationUs, const QJsonObject& args)
+{
+    QJsonObject event;
+    event["name"] = QString::fromLatin1(name);
+    event["cat"] = QString::fromLatin1(category);
+    event["ph"] = "X";
+    event["ts"] = startUs;
+    event["dur"] = durationUs;
+    event["pid"] = QCoreApplication::applicationPid();
+    event["tid"] = currentThreadId();
+    if (!args.isEmpty()) event["args"] = args;
+
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    appendEvent(s, event);
+}
+
+/* ---------- TraceSpan ---------- */
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+    : name_(name), category_(category), active_(Tracer::enabled())
+{
+    if (active_) startUs_ = Tracer::nowUs();
+}
+
+TraceSpan::~TraceSpan()
+{
+    // 记录期间被关闭时丢弃这条事件
+    if (active_ && Tracer::enabled()) {
+        Tracer::writeComplete(name_, category_, startUs_, Tracer::nowUs() - startUs_, args_);
+    }
+}
+
+TraceSpan& TraceSpan::arg(const char* key, int value)
+{
+    if (active_) args_[QLatin1String(key)] = value;
+    return *this;
+}
+
+TraceSpan& TraceSpan::arg(const char* key, qint64 value)
+{
+    if (active_) args_[QLatin1String(key)] = value;
+    return *this;
+}
+
+TraceSpan& TraceSpan::arg(const char* key, double value)
+{
+    if (active_) args_[QLatin1String(key)] = value;
+    return *this;
+}
+
+TraceSpan& TraceSpan::arg(const char* key, bool value)
+{
+    if (active_) args_[QLatin1String(key)] = value;
+    return *this;
+}
+
+TraceSpan& TraceSpan::arg(const char* key, const QString& value)
+{
+    if (active_) args_[QLatin1String(key)] = value;
+    return *this;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+
+/* Chrome / Perfetto 跟踪事件（trace event）记录器
+   探针始终编译在内，默认关闭；关闭时每个探针只有一次原子读的开销。
+   开启后每个 TraceSpan 写出一条 "ph":"X" 完整事件，生成的 JSON 文件
+   可以直接在 chrome://tracing 或 ui.perfetto.dev 中打开。 */
+class Tracer
+{
+public:
+    // 开始记录到指定文件，已在记录时先结束上一次记录
+    static bool start(const QString& filename);
+    // 结束记录并关闭文件
+    static void stop();
+    // 若设置了环境变量 FLOWDRAW_TRACE=<文件名>，开始记录
+    static bool startFromEnvironment();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static QString currentFile();
+
+    // 写出一条完整事件（时间单位：微秒，相对于开始记录的时刻）
+    static void writeComplete(const char* name, const char* category,
+                              double startUs, double durationUs, const QJsonObject& args);
+    // 当前时刻（微秒）
+    static double nowUs();
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+/* 作用域探针：构造时记录开始时刻，析构时写出事件
+   用法：
+       TraceSpan span("Document::saveToFile", "io");
+       span.arg("shapes", count);                     */
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name, const char* category = "flowdraw");
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // 附加参数，关闭记录时不做任何事
+    TraceSpan& arg(const char* key, int value);
+    TraceSpan& arg(const char* key, qint64 value);
+    TraceSpan& arg(const char* key, double value);
+    TraceSpan& arg(const char* key, bool value);
+    TraceSpan& arg(const char* key, const QString& value);
+
+    bool active() const { return active_; }
+
+private:
+    const char* name_;
+    const char* category_;
+    bool        active_;
+    double      startUs_ = 0;
+    QJsonObject args_;
+};